@@ -0,0 +1,109 @@
+/*
+ * \brief  Base of CDMA sessions, which run a transfer in the calling thread
+ * \author Johannes Fischer
+ * \date   2019-10-15
+ */
+
+
+#ifndef _CDMA_BLOCKING_SESSION_H_
+#define _CDMA_BLOCKING_SESSION_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/attached_ram_dataspace.h>
+#include <base/lock.h>
+#include <cdma_session/cdma_session.h>
+
+/* local includes */
+#include <cdma/driver.h>
+
+namespace Cdma {
+    class Blocking_session;
+}
+
+
+/**
+ * Sessions, which are implemented in the component of the client, block
+ * until a transfer completes, like the calls of `Session_client`. This
+ * class provides the state, which is common to all of them: outcome and
+ * failed range of the last transfer, the progress cursor and the batch.
+ */
+class Cdma::Blocking_session : public Cdma::Session
+{
+private:
+
+    // threads of the component share the session, like a `Session_client`
+    Genode::Lock _lock;
+
+    Genode::Signal_context_capability _completion_sigh;
+    Status _status = SUCCESS;
+
+    Genode::Attached_ram_dataspace _progress_ds;
+    Genode::Attached_ram_dataspace _batch_ds;
+
+    void _signal()
+    {
+        if(_completion_sigh.valid())
+            Genode::Signal_transmitter(_completion_sigh).submit();
+    }
+
+protected:
+
+    // range which was not copied by the last failed transfer
+    Range _failed { 0, 0 };
+
+    // completion cursor, which is shared with other threads of the component
+    Progress &_progress;
+    unsigned _progress_interval = 0;
+
+    Batch &_batch;
+
+    /**
+     * Run a transfer by `fn`, record its outcome and rethrow its exception.
+     * The completion is signalled nevertheless, if a handler is registered.
+     */
+    template <typename FN>
+    void _transfer(FN const &fn)
+    {
+        Genode::Lock::Guard guard(_lock);
+        _failed = Range { 0, 0 };
+        _status = PENDING;
+        try {
+            fn();
+            _status = SUCCESS;
+        }
+        catch(Cdma::Function_unsupported)   { _status = FUNCTION_UNSUPPORTED;   _signal(); throw; }
+        catch(Cdma::Invalid_memcpy_address) { _status = INVALID_MEMCPY_ADDRESS; _signal(); throw; }
+        catch(Cdma::Memcpy_timeout)         { _status = MEMCPY_TIMEOUT;         _signal(); throw; }
+        catch(Cdma::Exception)              { _status = INTERNAL_MEMCPY_ERROR;  _signal(); throw; }
+        _signal();
+    }
+
+    Blocking_session(Genode::Env &env)
+        :
+        _progress_ds(env.ram(), env.rm(), sizeof(Progress)),
+        _batch_ds(env.ram(), env.rm(), sizeof(Batch)),
+        _progress(*_progress_ds.local_addr<Progress>()),
+        _batch(*_batch_ds.local_addr<Batch>())
+    { }
+
+public:
+
+    void completion_sigh(Genode::Signal_context_capability sigh) override {
+        _completion_sigh = sigh; }
+
+    Status result() override { return _status; }
+
+    Genode::Dataspace_capability batch_dataspace() override { return _batch_ds.cap(); }
+    Genode::Dataspace_capability progress_dataspace() override { return _progress_ds.cap(); }
+    void progress_interval(unsigned descriptors) override { _progress_interval = descriptors; }
+
+    Range failed_range() override { return _failed; }
+
+    /**
+     * Fill `size` bytes at physical address `dst` with zeros
+     */
+    void zero(Genode::addr_t dst, Genode::size_t size) { memset(dst, 0, size); }
+};
+
+#endif /* _CDMA_BLOCKING_SESSION_H_ */
@@ -11,14 +11,43 @@
 /* Genode includes */
 #include <base/attached_io_mem_dataspace.h>
 #include <util/mmio.h>
+#include <util/register.h>
 
 
 namespace Cdma {
 	using namespace Genode;
 	class Mmio_cdma;
+	struct Descriptor;
 }
 
 
+/**
+ * Scatter Gather Transfer Descriptor as it is located in memory. The device
+ * fetches the descriptor and writes back `status` after processing it.
+ */
+struct Cdma::Descriptor
+{
+    uint32_t nxtdesc_pntr;
+    uint32_t nxtdesc_pntr_msb;
+    uint32_t sa;
+    uint32_t sa_msb;
+    uint32_t da;
+    uint32_t da_msb;
+    uint32_t control;   // bytes to transfer
+    uint32_t status;
+    uint32_t reserved[8];
+
+    struct Status : Genode::Register<32>
+    {
+        struct Transferred_bytes : Bitfield<0, 26> {};
+        struct IntErr : Bitfield<28, 1> {};
+        struct SlvErr : Bitfield<29, 1> {};
+        struct DecErr : Bitfield<30, 1> {};
+        struct Cmplt : Bitfield<31, 1> {};
+    };
+};
+
+
 struct Cdma::Mmio_cdma :  Attached_io_mem_dataspace, Mmio
 {
 	Mmio_cdma(Genode::Env &env, Genode::addr_t const mmio_address)
@@ -84,6 +113,47 @@ struct Cdma::Mmio_cdma :  Attached_io_mem_dataspace, Mmio
     struct BTT : Register<0x28, 32>{};
 
 
+    // Shadow of CDMACR. Every access to the device memory is an uncached
+    // transfer on AXI-Lite. Therefore the control bits are composed in
+    // software and written with a single access.
+    CDMACR::access_t _control = 0;
+
+    /**
+     * Set a bitfield of CDMACR in the shadow register.
+     */
+    template <typename BITFIELD>
+    void control(typename BITFIELD::access_t const value)
+    {
+        BITFIELD::set(_control, value);
+    }
+
+    /**
+     * Write the shadow register to CDMACR.
+     */
+    void commit_control() { write<CDMACR>(_control); }
+
+    /**
+     * Reset the CDMA IP core. The control register returns to its reset
+     * value, which is mirrored by the shadow register.
+     */
+    void reset_control()
+    {
+        write<CDMACR>(CDMACR::Reset::bits(1));
+        _control = CDMACR::IRQThreshold::bits(1);
+    }
+
+    /**
+     * Read CDMASR once. The bitfields are decoded from the returned
+     * snapshot by `CDMASR::<Bitfield>::get(status)`.
+     */
+    CDMASR::access_t status() { return read<CDMASR>(); }
+
+    /**
+     * Clear interrupt bits of CDMASR. The bits are cleared by writing one,
+     * thus no read-modify-write is required.
+     */
+    void clear_status(CDMASR::access_t const irq_bits) { write<CDMASR>(irq_bits); }
+
 };
 
 #endif // _CDMA_H_
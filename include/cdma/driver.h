@@ -20,6 +20,7 @@
 #include <dataspace/client.h>
 #include <region_map/client.h>
 #include <base/lock.h>
+#include <util/xml_node.h>
 
 namespace Cdma {
 	using namespace Genode;
@@ -29,6 +30,173 @@ namespace Cdma {
     struct Function_unsupported : Exception { };
     struct Invalid_memcpy_address : Exception { };
     struct Internal_memcpy_error : Exception { };
+    struct Memcpy_timeout : Exception { };
+
+    // a session got a transfer, while its previous one is still running
+    struct Session_busy : Exception { };
+
+    /**
+     * Outcome of an asynchronous request of a session, which maps to the
+     * exceptions above
+     */
+    enum Status
+    {
+        SUCCESS,
+        PENDING,
+        FUNCTION_UNSUPPORTED,
+        INVALID_MEMCPY_ADDRESS,
+        INTERNAL_MEMCPY_ERROR,
+        MEMCPY_TIMEOUT
+    };
+
+    /**
+     * Byte range relative to the start of a transfer
+     */
+    struct Range
+    {
+        Genode::size_t offset;
+        Genode::size_t size;
+    };
+
+    /**
+     * Completion cursor of a transfer, which is located in memory shared
+     * with the client. The driver updates it every few completed
+     * descriptors, such that the client can process the copied part while
+     * the transfer is still running.
+     */
+    struct Progress
+    {
+        // incremented, whenever a new transfer starts
+        Genode::uint32_t volatile transfer;
+
+        // bytes from the start of the current transfer, which are copied
+        Genode::size_t volatile completed;
+    };
+
+    /**
+     * Limits of the memory bandwidth, which is consumed by the CDMA.
+     * Transfers are split into segments, which are submitted one after
+     * another. After each segment, the driver pauses until the segment fits
+     * into the budget.
+     */
+    struct Throttle
+    {
+        // maximum bytes per second, `0` is unlimited
+        Genode::size_t bandwidth = 0;
+
+        // time slice in which the bandwidth is metered
+        unsigned slice_us = 1000;
+
+        // percentage of time the CDMA may be busy, `100` is unlimited
+        unsigned duty = 100;
+
+        bool active() const { return bandwidth || duty < 100; }
+    };
+
+    /**
+     * Hardware profile of the CDMA IP core, which is fixed by the hardware
+     * design. The register sequences of the driver are instantiated for
+     * every profile, such that a profile does not pay for the features of
+     * another one.
+     *
+     * @param SG Scather gather mode is used
+     *
+     * @param ADDR_64 Addresses are wider than 32 bit, i.e. the `*_MSB`
+     * registers and descriptor fields exist
+     *
+     * @param DRE The data realignment engine is present, thus addresses do
+     * not need to be aligned to the data width
+     *
+     * @param DATA_WIDTH Data width in bytes, to which addresses are aligned
+     * without DRE, `1` with DRE
+     */
+    template <bool SG, bool ADDR_64, bool DRE, unsigned DATA_WIDTH>
+    struct Profile
+    {
+        static constexpr bool sg = SG;
+        static constexpr bool addr_64 = ADDR_64;
+        static constexpr bool dre = DRE;
+        static constexpr unsigned data_width = DATA_WIDTH;
+    };
+
+    /**
+     * Properties of the hardware design, which can not be probed
+     */
+    struct Hardware
+    {
+        bool addr_64 = false;
+        bool dre = false;
+
+        // data width of the memory-mapped interface in bytes
+        unsigned data_width = 4;
+    };
+
+    /**
+     * Destinations of a fan-out copy, which all receive the same bytes
+     */
+    struct Destinations
+    {
+        enum { MAX = 4 };
+
+        Genode::addr_t addr[MAX];
+        unsigned count;
+    };
+
+    /**
+     * Single copy of a batch
+     */
+    struct Copy
+    {
+        Genode::addr_t dst;
+        Genode::addr_t src;
+        Genode::size_t size;
+    };
+
+    /**
+     * List of copies, which is located in memory shared with the client
+     * and submitted as a single descriptor chain
+     */
+    struct Batch
+    {
+        enum { MAX = 256 };
+
+        Copy copy[MAX];
+    };
+
+    /**
+     * Strided copy of `rows` rows of `row_size` bytes, e.g. a rectangle of
+     * a framebuffer. Consecutive rows start `pitch` bytes apart.
+     */
+    struct Stride
+    {
+        Genode::addr_t dst;
+        Genode::size_t dst_pitch;
+        Genode::addr_t src;
+        Genode::size_t src_pitch;
+        Genode::size_t row_size;
+        unsigned rows;
+    };
+
+    /**
+     * Transfer limits of the CDMA and measured costs of a copy, which are
+     * determined when the driver starts.
+     */
+    struct Limits
+    {
+        // largest number of bytes of a single descriptor or chunk
+        Genode::size_t max_btt;
+
+        // bytes per descriptor or chunk, aligned to the page size
+        Genode::size_t chunk_size;
+
+        // copies smaller than this are faster by the CPU, `0` if not
+        // calibrated
+        Genode::size_t crossover;
+
+        // measured throughput in MiB/s, `0` if not calibrated
+        Genode::size_t dma_throughput;
+        Genode::size_t cpu_throughput;
+    };
 }
 
 
@@ -37,11 +205,185 @@ class Cdma::Driver
 private:
     Mmio_cdma _mmio_cdma;
     bool _sg_enabled;
+    Hardware const _hardware;
+
     bool _is_supported;
     Timer::Connection _timer;
+
+    // time until a CDMA, which does not become idle after the reset, is
+    // considered missing
+    static const Genode::uint64_t PROBE_TIMEOUT_US = 500000;
 	Lock _lock;
 
-    static const uint32_t MAX_BTT = 0x007FFFFF; // MAX_BURST_LEN × (AXI_DATA_WIDTH/8) TODO
+    // A transfer which does not raise an interrupt in time is aborted. The
+    // timeout is `_timeout_ms` plus `TIMEOUT_MS_PER_MIB` for every MiB.
+    static const unsigned TIMEOUT_MS_PER_MIB = 10;
+
+    // delay in units of 125 clock cycles after the last completed
+    // descriptor, until the delay interrupt of a chain is raised
+    static const unsigned IRQ_DELAY = 8;
+
+    // the interrupt threshold of a chain is an 8-bit counter
+    enum { MAX_IRQ_THRESHOLD = 0xff };
+    unsigned _timeout_ms;
+    Timer::Connection _watchdog;
+    Genode::Signal_context _timeout_ctx;
+
+    // number of times failed descriptors are resubmitted after a reset
+    unsigned _retries;
+
+    enum Completion { COMPLETE, FAILED, TIMEOUT };
+
+    // status register at the time of the last error interrupt
+    Mmio_cdma::CDMASR::access_t _error_status = 0;
+
+    // operations of the hardware profile, which is selected when the driver
+    // starts. An operation dispatches once through this table, everything
+    // below it is instantiated for the profile and does not branch on it.
+    struct Engine
+    {
+        void (Driver::*transfer)(Destinations const &, Genode::addr_t,
+                                 Genode::size_t, Range *, bool);
+        void (Driver::*batch)(Copy const *, unsigned, Range *);
+        void (Driver::*stride)(Genode::addr_t, Genode::size_t, Genode::addr_t,
+                               Genode::size_t, Genode::size_t, unsigned, Range *);
+    };
+    Engine const *_engine;
+
+    /**
+     * Engine of the operations instantiated for `PROFILE`
+     */
+    template <typename PROFILE>
+    static Engine const &engine();
+
+    /**
+     * Engine of the profile with a data width of `data_width` bytes or DRE
+     */
+    template <bool SG, bool ADDR_64>
+    static Engine const &select_engine(bool dre, unsigned data_width);
+
+    /**
+     * Engine of the profile matching the arguments
+     */
+    static Engine const &select_engine(bool sg, Hardware const &hardware);
+
+    /**
+     * Write descriptor `i` of a chain
+     */
+    template <typename PROFILE>
+    void write_descriptor(Genode::uint32_t i, Genode::uint64_t sa, Genode::uint64_t da,
+                          Genode::size_t btt);
+
+    /**
+     * Write the head and tail pointer of a chain of `count` descriptors,
+     * which starts the transfer.
+     */
+    template <typename PROFILE>
+    void start_chain(Genode::uint32_t count);
+
+    /**
+     * Check the alignment to the data width, which is required without
+     * realignment engine.
+     */
+    template <typename PROFILE>
+    bool aligned(Genode::uint64_t dst, Genode::uint64_t src);
+
+    // completion cursor of the current transfer, which is updated every
+    // `_progress_interval` descriptors
+    Progress *_progress = nullptr;
+    unsigned _progress_interval = 0;
+    bool _interval_clamped = false;
+
+    // the cursor of a segmented transfer starts at the current segment
+    Genode::size_t _progress_base = 0;
+
+    // global throttle and the throttle of the current transfer
+    Throttle _throttle;
+    Throttle _transfer_throttle;
+
+    // segment size of a duty cycle without bandwidth limit
+    static const Genode::size_t DUTY_SEGMENT_SIZE = 0x100000;
+
+    /**
+     * Destinations moved by `offset` bytes
+     */
+    static Destinations offset_of(Destinations const &dst, Genode::size_t offset);
+
+    /**
+     * Size of the segments in which a throttled transfer is split.
+     */
+    Genode::size_t segment_size(Genode::size_t size);
+
+    /**
+     * Pause after a segment of `size` bytes, which was started at
+     * `start_us`, until it fits into the budget of the throttle.
+     */
+    void throttle_pause(Genode::uint64_t start_us, Genode::size_t size);
+
+    /**
+     * Submit the prepared descriptors and resubmit those which did not
+     * complete. `count` is set to the number of descriptors of the last
+     * submission.
+     */
+    template <typename PROFILE>
+    Completion sg_run(Genode::uint32_t &count, Genode::size_t pending, bool keyhole_read);
+
+    /**
+     * Run `count` copies with as few descriptor chains as possible. Copy `i`
+     * is returned by `copy_at(i)`.
+     *
+     * @param failed Set to the index of the first copy which did not
+     * complete (`offset`) and the number of copies from there on (`size`).
+     */
+    template <typename PROFILE, typename FN>
+    void sg_copies(unsigned count, FN const &copy_at, Range &failed);
+
+    /**
+     * Run `count` copies in simple or scather gather mode.
+     */
+    template <typename PROFILE, typename FN>
+    void run_copies(unsigned count, FN const &copy_at, Range *failed);
+
+    /**
+     * Run the `count` copies of a batch.
+     */
+    template <typename PROFILE>
+    void run_batch(Copy const *copies, unsigned count, Range *failed);
+
+    /**
+     * Run the `rows` copies of a strided transfer.
+     */
+    template <typename PROFILE>
+    void run_stride(Genode::addr_t dst, Genode::size_t dst_pitch,
+                    Genode::addr_t src, Genode::size_t src_pitch,
+                    Genode::size_t row_size, unsigned rows, Range *failed);
+
+    /**
+     * Run a segment of a transfer in simple or scather gather mode.
+     */
+    template <typename PROFILE>
+    void transfer_segment(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                          Range &failed, bool keyhole_read);
+
+    // width of the BTT register, if it is not configured. The register is
+    // configured with 8 to 26 bits in the hardware design.
+    static const uint32_t DEFAULT_MAX_BTT = 0x007FFFFF;
+    enum { MIN_BTT_WIDTH = 8, MAX_BTT_WIDTH = 26 };
+
+    /**
+     * Width of a BTT register, which holds at most `max_btt` bytes, `0` if
+     * `max_btt` does not correspond to a legal width
+     */
+    static unsigned btt_width(Genode::size_t max_btt);
+
+    // configured BTT width, descriptor size and calibrated crossover
+    Limits _limits;
+
+    // size of each of both scratch dataspaces used by the calibration
+    static const Genode::size_t CALIBRATION_SIZE = 0x200000;
+
+    // copies per measured size during calibration
+    static const unsigned CALIBRATION_REPEAT = 16;
 
     // Even if the driver supports 64-bit addresses, the number of descriptors
     // is set to maxium 512. This means that it is restricted to 4 GB of
@@ -57,6 +399,13 @@ private:
     void *_td_ds_addr;
     Genode::uint64_t _td_phys_addr;
 
+    // source of memset, which is read with keyhole read. It is filled with
+    // the replicated byte pattern.
+    static const uint32_t PATTERN_DS_SIZE = 0x1000;
+    Genode::Ram_dataspace_capability _pattern_ds_cap;
+    Genode::uint8_t *_pattern_ds_addr;
+    Genode::uint64_t _pattern_phys_addr;
+
     // interrupts for transfer
     Genode::Irq_connection _irq;
     Genode::Signal_receiver sig_rec;
@@ -65,48 +414,160 @@ private:
     Driver(Genode::Env &env,
            Genode::addr_t cdma_address,
            Genode::uint32_t irq_number,
-           bool sg_enabled);
+           bool sg_enabled,
+           unsigned timeout_ms,
+           unsigned retries,
+           Genode::size_t max_btt,
+           bool calibrate,
+           Hardware const &hardware);
     
     ~Driver();
 
+    /**
+     * Measure DMA and CPU copies of different sizes on scratch dataspaces
+     * and derive the descriptor size and the crossover size from it.
+     */
+    void calibrate();
+
+    /**
+     * Time of `CALIBRATION_REPEAT` DMA copies of `size` bytes in us.
+     */
+    Genode::uint64_t time_dma(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size);
+
+    /**
+     * Time of `CALIBRATION_REPEAT` CPU copies of `size` bytes in us.
+     */
+    Genode::uint64_t time_cpu(void *dst, void const *src, Genode::size_t size);
+
+    /**
+     * Descriptor `i` in the attached descriptor dataspace.
+     */
+    Descriptor volatile *td(Genode::uint32_t i);
+
+    /**
+     * Physical address of descriptor `i`.
+     */
+    Genode::uint64_t td_phys_addr(Genode::uint32_t i);
+
+    /**
+     * Chain the first `count` descriptors and clear their status.
+     */
+    template <typename PROFILE>
+    void link_descriptors(Genode::uint32_t count);
+
+    /**
+     * Submit the first `count` descriptors and wait for their completion.
+     *
+     * @param size Number of bytes described by the descriptors.
+     *
+     * @param keyhole_read Read all bytes from the source address of each
+     * descriptor, instead of incrementing it.
+     */
+    template <typename PROFILE>
+    Completion sg_transfer(Genode::uint32_t count, Genode::size_t size,
+                           bool keyhole_read);
+
+    /**
+     * Wait until the transfer completes, fails or times out.
+     *
+     * @param size Number of bytes of the transfer.
+     *
+     * @param count Number of descriptors or `0` in simple mode.
+     */
+    Completion wait_for_completion(Genode::size_t size, Genode::uint32_t count);
+
+    /**
+     * Update the completion cursor of the current transfer.
+     */
+    void report_progress(Genode::size_t completed);
+
+    /**
+     * Throw the exception, which matches a failed transfer.
+     */
+    void throw_error(Completion completion);
+
     /** 
      * Internal implementation for copying memory based on the scather
      * mode. Only aligned can be copied. This function supports more than
-     * `MAX_BTT` bytes of data.
+     * `Limits::max_btt` bytes of data. Descriptors which are not completed, are
+     * resubmitted after resetting the CDMA IP core.
      *
-     * @param dst Physical destination address
+     * The descriptors of all destinations of a chunk are adjacent in the
+     * chain, such that a fan-out copy is a single submission.
+     *
+     * @param dst Physical destination addresses
      *
      * @param src Physical source address
      *
      * @param size_t Number of bytes to copy.
+     *
+     * @param failed Set to the range which could not be copied to at least
+     * one destination.
+     *
+     * @param keyhole_read Read all bytes from `src`, instead of incrementing
+     * the source address.
      */    
-    void sg_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t size);
+    template <typename PROFILE>
+    void sg_memcpy(Destinations const &dst, Genode::uint64_t src, Genode::size_t size,
+                   Range &failed, bool keyhole_read);
 
     /** 
      * Internal implementation for copying memory based on the simple mode. Only
      * aligned can be copied. Furthmermore this function can copy up to
-     * `MAX_BTT` bytes.
+     * `Limits::max_btt` bytes.
      *
      * @param dst Physical destination address
      *
      * @param src Physical source address
      *
-     * @param btt Number of bytes to copy. Maximum of bytes is `MAX_BTT`.
+     * @param btt Number of bytes to copy. Maximum of bytes is `Limits::max_btt`.
+     *
+     * @param keyhole_read Read all bytes from `src`, instead of incrementing
+     * the source address.
      */        
-    void simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t btt);
+    template <typename PROFILE>
+    Completion simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t btt,
+                             bool keyhole_read);
 
     /** 
      * Internal implementation for copying memory based on the simple mode. Only
-     * aligned can be copied. This function supports more than `MAX_BTT` bytes
+     * aligned can be copied. This function supports more than `Limits::max_btt` bytes
      * of data, but internally calls `simple_memcpy`.
      *
-     * @param dst Physical destination address
+     * @param dst Physical destination addresses
      *
      * @param src Physical source address
      *
      * @param size Number of bytes to copy.
+     *
+     * @param failed Set to the range which could not be copied to at least
+     * one destination.
+     *
+     * @param keyhole_read Read all bytes from `src`, instead of incrementing
+     * the source address.
      */        
-    void multiple_simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t size);
+    template <typename PROFILE>
+    void multiple_simple_memcpy(Destinations const &dst, Genode::uint64_t src, Genode::size_t size,
+                                Range &failed, bool keyhole_read);
+
+    /**
+     * Run a transfer in simple or scather gather mode.
+     */
+    template <typename PROFILE>
+    void run_transfer(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                      Range *failed, bool keyhole_read);
+
+    /**
+     * Run a transfer with the operations of the hardware profile.
+     */
+    void transfer(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                  Range *failed, bool keyhole_read) {
+        (this->*_engine->transfer)(dst, src, size, failed, keyhole_read); }
+
+    /**
+     * Select the completion cursor for the following transfers.
+     */
+    void progress(Progress *progress, unsigned interval);
 
     /** 
      * print descriptor list
@@ -149,11 +610,40 @@ public:
      * mode. This need to be supported by the hardware implementation. If it is
      * not supported, the driver will automatically fallback to simple mode.
      *
+     * @param timeout_ms Minimal time until a transfer without interrupt is
+     * aborted.
+     *
+     * @param retries Number of times, the failed part of a transfer is
+     * resubmitted.
+     *
+     * @param max_btt Largest number of bytes per descriptor, at most `2^w - 1`
+     * for the BTT width `w` of the hardware design. `0` assumes the width
+     * of the default design.
+     *
+     * @param calibrate Measure DMA and CPU copies in order to determine the
+     * descriptor size and the crossover size.
+     *
+     * @param hardware Address width and realignment engine of the hardware
+     * design, which select the hardware profile together with the
+     * availability of scather gather mode.
+     *
      */    
     static Driver& factory(Genode::Env &env,
                            Genode::addr_t cmda_address,
                            Genode::uint32_t irq_number,
-                           bool sg_enabled);
+                           bool sg_enabled,
+                           unsigned timeout_ms = 1000,
+                           unsigned retries = 2,
+                           Genode::size_t max_btt = 0,
+                           bool calibrate = false,
+                           Hardware const &hardware = Hardware());
+
+    /**
+     * Create the driver from the attributes of a `<cdma>` node, which are
+     * described in `doc/cdma_drv/cdma_drv.md`. The node also configures the
+     * global throttle.
+     */
+    static Driver& factory(Genode::Env &env, Genode::Xml_node const &config);
 
     /** 
      * Hardware accelerated copying of memory. This function supports simple and
@@ -167,13 +657,116 @@ public:
      *
      * @exception Internal_memcpy_address An internal error in hardware occured.
      *
+     * @exception Memcpy_timeout The CDMA IP core did not finish in time.
+     *
      * @param dst Physical destination address
      *
      * @param src Physical source address
      *
      * @param size Number of bytes to copy.
+     *
+     * @param failed If an exception is thrown, it is set to the range which
+     * was not copied. Everything outside of this range was copied.
+     *
+     * @param progress Completion cursor, which is updated while copying.
+     *
+     * @param progress_interval Number of descriptors after which `progress`
+     * is updated. `0` only updates it after the transfer. In scather gather
+     * mode, an interval above `MAX_IRQ_THRESHOLD` is clamped with a
+     * warning.
+     *
+     * @param throttle Bandwidth limit of this transfer. If it is not active,
+     * the global throttle applies.
      */            
-    void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size);
+    void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size,
+                Range *failed = nullptr, Progress *progress = nullptr,
+                unsigned progress_interval = 0,
+                Throttle const &throttle = Throttle());
+
+    /** 
+     * Hardware accelerated filling of memory with a byte value. The CDMA
+     * reads the value repeatedly from a pattern buffer in keyhole read mode.
+     * Exceptions and limitations are identical to `memcpy`.
+     *
+     * @param dst Physical destination address
+     *
+     * @param value Byte which is written to every byte of the destination
+     *
+     * @param size Number of bytes to fill.
+     *
+     * @param failed If an exception is thrown, it is set to the range which
+     * was not filled.
+     *
+     * @param throttle Bandwidth limit of this transfer. If it is not active,
+     * the global throttle applies.
+     */            
+    void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size,
+                Range *failed = nullptr, Throttle const &throttle = Throttle());
+
+    /** 
+     * Copy `size` bytes from `src` to every destination of `dst` in one
+     * submission. In scather gather mode, the descriptors of all
+     * destinations are interleaved in a single chain, thus the transfer
+     * raises a single interrupt.
+     *
+     * @exception Invalid_memcpy_address No or more than `Destinations::MAX`
+     * destinations.
+     *
+     * @param failed If an exception is thrown, it is set to the range which
+     * was not copied to at least one destination.
+     *
+     * @param throttle Bandwidth limit of this transfer. If it is not active,
+     * the global throttle applies.
+     */            
+    void fanout(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                Range *failed = nullptr, Throttle const &throttle = Throttle());
+
+    /** 
+     * Run `count` independent copies. In scather gather mode, all copies
+     * are submitted with a single descriptor chain, as long as the
+     * descriptors suffice.
+     *
+     * @exception Invalid_memcpy_address More than `Batch::MAX` copies.
+     *
+     * @param failed If an exception is thrown, `offset` is set to the index
+     * of the first copy which did not complete and `size` to the number of
+     * copies from there on. The copies in front of it are complete.
+     *
+     * @param throttle Bandwidth limit of this transfer. If it is not active,
+     * the global throttle applies.
+     */            
+    void batch(Copy const *copies, unsigned count, Range *failed = nullptr,
+               Throttle const &throttle = Throttle());
+
+    /** 
+     * Copy `rows` rows of `row_size` bytes. Consecutive rows start
+     * `src_pitch` and `dst_pitch` bytes apart, e.g. a rectangle of a
+     * framebuffer. In scather gather mode, every row is a descriptor of a
+     * single chain.
+     *
+     * @param failed If an exception is thrown, `offset` is set to the first
+     * row which did not complete and `size` to the number of rows from there
+     * on.
+     *
+     * @param throttle Bandwidth limit of this transfer. If it is not active,
+     * the global throttle applies.
+     */            
+    void stride(Genode::addr_t dst, Genode::size_t dst_pitch,
+                Genode::addr_t src, Genode::size_t src_pitch,
+                Genode::size_t row_size, unsigned rows,
+                Range *failed = nullptr, Throttle const &throttle = Throttle());
+
+    /**
+     * Set the global bandwidth limit, which applies to all sessions without
+     * an own limit.
+     */
+    void throttle(Throttle const &throttle) { _throttle = throttle; }
+
+    /**
+     * Probed transfer limits and, if calibrated, the crossover size below
+     * which a CPU copy is faster.
+     */
+    Limits limits() const { return _limits; }
 
     /** 
      * Checks, whether the CDMA IP core is available.
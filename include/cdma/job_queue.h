@@ -0,0 +1,114 @@
+/*
+ * \brief  Thread which runs queued CDMA jobs one after another
+ * \author Johannes Fischer
+ * \date   2019-10-11
+ */
+
+
+#ifndef _CDMA_JOB_QUEUE_H_
+#define _CDMA_JOB_QUEUE_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/thread.h>
+#include <base/lock.h>
+#include <base/semaphore.h>
+#include <util/list.h>
+
+namespace Cdma {
+    class Job_queue;
+}
+
+
+/**
+ * A transfer blocks its caller until the CDMA raises its interrupt. The job
+ * queue runs transfers in its own thread in submission order, such that the
+ * submitter continues meanwhile. The driver queues the requests of all
+ * sessions, such that its entrypoint never blocks. rtcr queues the copies of
+ * ram dataspaces, such that the checkpointing thread continues with the
+ * CPU-bound checkpointables.
+ */
+class Cdma::Job_queue : public Genode::Thread
+{
+public:
+
+    class Job : public Genode::List<Job>::Element
+    {
+        friend class Job_queue;
+
+    private:
+
+        bool _pending = false;
+
+        // the owner gave up the job while it was executed
+        bool _released = false;
+
+    public:
+
+        virtual ~Job() { }
+
+        /**
+         * Executed by the thread of the queue
+         */
+        virtual void execute() = 0;
+
+        /**
+         * Called by the thread of the queue as soon as the job is not
+         * pending anymore, e.g. to signal its completion. The queue is
+         * locked meanwhile, thus the job is not destroyed concurrently and
+         * must not call the queue.
+         */
+        virtual void completed() { }
+
+        /**
+         * Called by the thread of the queue after a released job is
+         * executed. The job is not touched by the queue afterwards, thus it
+         * may destroy itself.
+         */
+        virtual void release() { }
+
+        bool pending() const { return _pending; }
+    };
+
+private:
+
+    enum { STACK_SIZE = 16*1024 };
+
+    Genode::Lock      _lock;
+    Genode::List<Job> _jobs;
+    Job              *_tail = nullptr;
+    Genode::Semaphore _submitted;
+
+    // threads waiting for an idle queue
+    Genode::Semaphore _idle;
+    unsigned          _pending = 0;
+    unsigned          _joiners = 0;
+
+    void entry() override;
+
+public:
+
+    Job_queue(Genode::Env &env, Genode::Thread::Name const &name);
+
+    /**
+     * Enqueue a job. The job must not be pending.
+     */
+    void submit(Job &job);
+
+    /**
+     * Remove a job which is not started yet. Used before a job is destroyed.
+     *
+     * @return `false`, if the job is executed right now. The job is released
+     *         instead, i.e. the queue calls `Job::release` once it completes,
+     *         and the caller must not destroy it.
+     */
+    bool cancel(Job &job);
+
+    /**
+     * Block until all submitted jobs are executed. Must not be called by an
+     * entrypoint, which has to stay responsive.
+     */
+    void join();
+};
+
+#endif // _CDMA_JOB_QUEUE_H_
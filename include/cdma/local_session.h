@@ -0,0 +1,63 @@
+/*
+ * \brief  CDMA session which runs the driver in the component of the client
+ * \author Johannes Fischer
+ * \date   2019-10-14
+ */
+
+
+#ifndef _CDMA_LOCAL_SESSION_H_
+#define _CDMA_LOCAL_SESSION_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+
+/* local includes */
+#include <cdma/blocking_session.h>
+#include <cdma/driver.h>
+#include <cdma/phys_cache.h>
+
+namespace Cdma {
+    class Local_session;
+}
+
+
+/**
+ * If a component is the only user of the CDMA, it can link the driver
+ * library and drive the CDMA IP core itself. Then a transfer is a plain
+ * function call instead of an RPC to `cdma_drv` and a completion signal.
+ * The component requires the `IO_MEM` and `IRQ` sessions of the CDMA.
+ */
+class Cdma::Local_session : public Cdma::Blocking_session
+{
+private:
+
+    Driver &_driver;
+    Throttle const _throttle;
+    Phys_cache _phys_cache;
+
+public:
+
+    /**
+     * @param driver Driver, which is created by `Driver::factory`
+     *
+     * @param throttle Bandwidth limit of the transfers of this session
+     */
+    Local_session(Genode::Env &env, Genode::Allocator &alloc, Driver &driver,
+                  Throttle const &throttle = Throttle());
+
+    void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size) override;
+    void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size) override;
+    void copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+              Genode::Dataspace_capability src, Genode::off_t src_offset,
+              Genode::size_t size) override;
+    void invalidate(Genode::Dataspace_capability ds) override;
+    void fanout(Destinations dst, Genode::addr_t src, Genode::size_t size) override;
+    void stride(Stride stride) override;
+    void batch(unsigned count) override;
+
+    bool is_supported() override { return _driver.is_supported(); }
+    Limits limits() override { return _driver.limits(); }
+};
+
+#endif /* _CDMA_LOCAL_SESSION_H_ */
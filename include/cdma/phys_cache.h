@@ -0,0 +1,159 @@
+/*
+ * \brief  Cache of the physical ranges of dataspaces of a CDMA session
+ * \author Johannes Fischer
+ * \date   2019-10-09
+ */
+
+#ifndef _CDMA_PHYS_CACHE_H_
+#define _CDMA_PHYS_CACHE_H_
+
+/* Genode includes */
+#include <base/allocator.h>
+#include <base/ipc.h>
+#include <dataspace/client.h>
+#include <util/list.h>
+
+/* local includes */
+#include <cdma/driver.h>
+
+namespace Cdma {
+    class Phys_cache;
+}
+
+
+/**
+ * A capability-based copy has to resolve the physical address of both
+ * dataspaces. Every resolution costs two RPCs to core, thus the resolved
+ * ranges are kept per session. The most recently used entry is first.
+ *
+ * A client may free a dataspace without `invalidate`. Therefore an entry is
+ * validated by a single RPC before each transfer. The entry holds a
+ * reference to the capability, thus its slot is not reused for another
+ * dataspace while cached. A freed dataspace fails the RPC or reports another
+ * size, then the entry is dropped and resolved again.
+ */
+class Cdma::Phys_cache
+{
+private:
+
+    struct Entry : Genode::List<Entry>::Element
+    {
+        Genode::Dataspace_capability cap;
+        Genode::addr_t phys_addr;
+        Genode::size_t size;
+
+        Entry(Genode::Dataspace_capability cap, Genode::addr_t phys_addr,
+              Genode::size_t size)
+            : cap(cap), phys_addr(phys_addr), size(size) {}
+    };
+
+    // the least recently used entry is dropped, if the cache is full
+    static const unsigned MAX_ENTRIES = 64;
+
+    Genode::Allocator &_alloc;
+    Genode::List<Entry> _entries;
+    unsigned _count = 0;
+
+    static bool _valid(Entry const &e)
+    {
+        try {
+            return Genode::Dataspace_client(e.cap).size() == e.size;
+        }
+        catch(Genode::Ipc_error) { return false; }
+    }
+
+public:
+
+    Phys_cache(Genode::Allocator &alloc) : _alloc(alloc) {}
+
+    ~Phys_cache()
+    {
+        while(Entry *e = _entries.first())
+        {
+            _entries.remove(e);
+            Genode::destroy(_alloc, e);
+        }
+    }
+
+    /**
+     * Physical address of `size` bytes at `offset` of `cap`.
+     *
+     * @exception Invalid_memcpy_address The capability is invalid, the
+     * dataspace is not backed by contiguous physical memory or the range
+     * exceeds it.
+     */
+    Genode::addr_t resolve(Genode::Dataspace_capability cap, Genode::off_t offset,
+                           Genode::size_t size)
+    {
+        if(!cap.valid())
+            throw Cdma::Invalid_memcpy_address();
+
+        Entry *e = _entries.first();
+        for(; e && !(e->cap == cap); e = e->next());
+
+        if(e)
+        {
+            _entries.remove(e);
+
+            // a stale entry would send the transfer to freed memory
+            if(!_valid(*e))
+            {
+                Genode::destroy(_alloc, e);
+                _count--;
+                e = nullptr;
+            }
+        }
+
+        if(!e)
+        {
+            // managed and freed dataspaces have no physical address
+            Genode::Dataspace_client ds(cap);
+            Genode::addr_t phys_addr = 0;
+            Genode::size_t ds_size = 0;
+            try {
+                phys_addr = ds.phys_addr();
+                ds_size = ds.size();
+            }
+            catch(Genode::Ipc_error) { }
+            if(!phys_addr)
+                throw Cdma::Invalid_memcpy_address();
+
+            if(_count == MAX_ENTRIES)
+            {
+                Entry *last = _entries.first();
+                for(; last->next(); last = last->next());
+                _entries.remove(last);
+                Genode::destroy(_alloc, last);
+                _count--;
+            }
+
+            e = new (_alloc) Entry(cap, phys_addr, ds_size);
+            _count++;
+        }
+        _entries.insert(e);
+
+        if(offset < 0 || (Genode::size_t)offset > e->size || size > e->size - offset)
+            throw Cdma::Invalid_memcpy_address();
+
+        return e->phys_addr + offset;
+    }
+
+    /**
+     * Drop the entry of `cap`, e.g. before the dataspace is freed
+     */
+    void invalidate(Genode::Dataspace_capability cap)
+    {
+        for(Entry *e = _entries.first(); e; e = e->next())
+        {
+            if(!(e->cap == cap))
+                continue;
+
+            _entries.remove(e);
+            Genode::destroy(_alloc, e);
+            _count--;
+            return;
+        }
+    }
+};
+
+#endif // _CDMA_PHYS_CACHE_H_
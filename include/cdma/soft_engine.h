@@ -0,0 +1,128 @@
+/*
+ * \brief  Parallel copy by the CPU cores, used if the CDMA is missing
+ * \author Johannes Fischer
+ * \date   2019-10-15
+ */
+
+
+#ifndef _CDMA_SOFT_ENGINE_H_
+#define _CDMA_SOFT_ENGINE_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <base/thread.h>
+#include <base/semaphore.h>
+#include <base/lock.h>
+
+namespace Cdma {
+    class Soft_engine;
+}
+
+
+/**
+ * Boards without the bitstream of the CDMA and x86 machines copy with the
+ * CPU instead. A single core does not saturate the memory bus, therefore a
+ * large copy is split into parts, which are copied by a pool of threads on
+ * all CPUs of the affinity space and by the calling thread.
+ */
+class Cdma::Soft_engine
+{
+private:
+
+    enum { STACK_SIZE = 16*1024 };
+
+    // copies below twice this size are not split, because waking up the
+    // workers costs more than they save
+    static const Genode::size_t PART_MIN = 0x20000;
+
+    // part of a copy or fill, which is executed by one thread
+    struct Part
+    {
+        void *dst;
+        void const *src;
+        Genode::size_t size;
+        Genode::uint8_t value;
+    };
+
+    class Worker : public Genode::Thread
+    {
+    private:
+
+        Soft_engine &_engine;
+        Genode::Semaphore _started;
+        Part _part { nullptr, nullptr, 0, 0 };
+
+        void entry() override;
+
+    public:
+
+        Worker(Genode::Env &env, Soft_engine &engine, Genode::Thread::Name const &name,
+               Genode::Affinity::Location location);
+
+        void start_part(Part const &part);
+    };
+
+    Genode::Allocator &_alloc;
+
+    // one copy is split at a time
+    Genode::Lock _lock;
+    Genode::Semaphore _finished;
+
+    Worker **_workers;
+    unsigned _count;
+
+    Soft_engine(Genode::Env &env, Genode::Allocator &alloc, unsigned threads);
+
+    ~Soft_engine();
+
+    static void _run(Part const &part);
+
+    /**
+     * Split `part` among the workers and the calling thread
+     */
+    void _split(Part const &part);
+
+public:
+
+    /**
+     * Engine shared by all sessions of the component
+     *
+     * @param threads Number of threads including the caller, `0` uses
+     * one thread per CPU of the affinity space
+     */
+    static Soft_engine &factory(Genode::Env &env, Genode::Allocator &alloc,
+                                unsigned threads = 0);
+
+    /**
+     * Copy `size` bytes with all threads
+     */
+    void copy(void *dst, void const *src, Genode::size_t size);
+
+    /**
+     * Fill `size` bytes with `value` with all threads
+     */
+    void set(void *dst, Genode::uint8_t value, Genode::size_t size);
+
+    /**
+     * Copy `size` bytes by the calling thread. It uses NEON on ARM and
+     * non-temporal SSE2 stores on x86, such that the copy does not evict the
+     * working set of the running components from the caches.
+     */
+    static void copy_kernel(void *dst, void const *src, Genode::size_t size);
+
+    /**
+     * Fill `size` bytes with `value` by the calling thread
+     */
+    static void set_kernel(void *dst, Genode::uint8_t value, Genode::size_t size);
+
+    /**
+     * Check whether `size` bytes are all zero by the calling thread. The
+     * scan stops at the first 64-byte block, which contains a set bit.
+     */
+    static bool zero_kernel(void const *src, Genode::size_t size);
+
+    unsigned threads() const { return _count + 1; }
+};
+
+#endif /* _CDMA_SOFT_ENGINE_H_ */
@@ -0,0 +1,116 @@
+/*
+ * \brief  CDMA session which copies with the CPU cores
+ * \author Johannes Fischer
+ * \date   2019-10-15
+ */
+
+
+#ifndef _CDMA_SOFT_SESSION_H_
+#define _CDMA_SOFT_SESSION_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <util/list.h>
+
+/* local includes */
+#include <cdma/blocking_session.h>
+#include <cdma/soft_engine.h>
+
+namespace Cdma {
+    class Soft_session;
+}
+
+
+/**
+ * Software replacement of the CDMA behind the same session interface. The
+ * engine copies between local mappings, therefore physical addresses are
+ * translated by the dataspaces known to the session. A dataspace becomes
+ * known by a capability-based `copy` or by `attach`. It stays attached until
+ * it is invalidated, or until every `attach` is paired with a `detach`. A transfer on an unknown physical range fails with
+ * `Invalid_memcpy_address` and reports the whole range as failed.
+ */
+class Cdma::Soft_session : public Cdma::Blocking_session
+{
+private:
+
+    struct Attachment : Genode::List<Attachment>::Element
+    {
+        Genode::Dataspace_capability cap;
+        char *local;
+        Genode::addr_t phys_addr;
+        Genode::size_t size;
+
+        // number of `attach` calls without `detach`
+        unsigned refs = 0;
+
+        Attachment(Genode::Dataspace_capability cap, char *local,
+                   Genode::addr_t phys_addr, Genode::size_t size)
+            : cap(cap), local(local), phys_addr(phys_addr), size(size) {}
+    };
+
+    Genode::Env &_env;
+    Genode::Allocator &_alloc;
+    Soft_engine &_engine;
+
+    Genode::Lock _attachments_lock;
+    Genode::List<Attachment> _attachments;
+
+    Attachment &_attachment(Genode::Dataspace_capability ds);
+
+    void _remove(Attachment &a);
+
+    /**
+     * Local address of `size` bytes at physical address `phys`
+     */
+    char *_local(Genode::addr_t phys, Genode::size_t size);
+
+    /**
+     * Local address of `size` bytes at `offset` of `ds`
+     */
+    char *_local(Genode::Dataspace_capability ds, Genode::off_t offset, Genode::size_t size);
+
+    /**
+     * Run `count` copies by `copy_at(i)`, see `Session::batch`
+     */
+    template <typename FN>
+    void _copies(unsigned count, FN const &copy_at);
+
+public:
+
+    Soft_session(Genode::Env &env, Genode::Allocator &alloc, Soft_engine &engine);
+
+    ~Soft_session();
+
+    /**
+     * Make the physical range of `ds` known to the physical-address
+     * transfers
+     */
+    void attach(Genode::Dataspace_capability ds);
+
+    /**
+     * Undo an `attach`. The local mapping of `ds` is removed by the last
+     * `detach`.
+     */
+    void detach(Genode::Dataspace_capability ds);
+
+    void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size) override;
+    void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size) override;
+    void copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+              Genode::Dataspace_capability src, Genode::off_t src_offset,
+              Genode::size_t size) override;
+    void invalidate(Genode::Dataspace_capability ds) override;
+    void fanout(Destinations dst, Genode::addr_t src, Genode::size_t size) override;
+    void stride(Stride stride) override;
+    void batch(unsigned count) override;
+
+    bool is_supported() override { return true; }
+
+    /**
+     * Copies have no size limit and there is no crossover to a CPU copy.
+     * The throughputs are unknown, which disables hybrid copies.
+     */
+    Limits limits() override { return Limits { ~0UL, ~0UL & ~0xfffUL, 0, 0, 0 }; }
+};
+
+#endif /* _CDMA_SOFT_SESSION_H_ */
@@ -12,6 +12,8 @@
 #include <base/stdint.h>
 #include <base/exception.h>
 #include <cdma/driver.h>
+#include <dataspace/capability.h>
+#include <base/signal.h>
 
 namespace Cdma {
 	struct Session;
@@ -23,14 +25,113 @@ struct Cdma::Session : Genode::Session
 
 	/*
 	 * An CDMA session consumes a dataspace capability for the session-object
-	 * allocation and its session capability.
+	 * allocation, the progress and batch dataspaces, the heap of the driver
+	 * for the session and its session capability.
+	 *
+	 * The RAM quota covers the session object, the progress and batch
+	 * dataspaces and the heap, which the driver allocates for the session.
 	 */
-	enum { CAP_QUOTA = 3 };
+	enum { CAP_QUOTA = 6, RAM_QUOTA = 64*1024 };
 
+	/*
+	 * Transfers (`memcpy`, `copy`, `memset`, `fanout`, `stride`, `batch`)
+	 * are queued by the driver and the call returns immediately. The
+	 * completion is signalled to `completion_sigh` and `result` reports
+	 * the outcome. `Session_client` waits for the completion, thus it keeps
+	 * the blocking semantics.
+	 *
+	 * A session runs one transfer at a time. A transfer, which is submitted
+	 * before the previous one completed, throws `Session_busy`, because the
+	 * entrypoint of the driver never waits for a transfer.
+	 */
+
+	/**
+	 * Register the handler for the completion of a transfer
+	 */
+	virtual void completion_sigh(Genode::Signal_context_capability sigh) = 0;
+
+	/**
+	 * Outcome of the last transfer, `PENDING` until it completes
+	 */
+	virtual Cdma::Status result() = 0;
 	
 	virtual void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size) = 0;
 	virtual bool is_supported() = 0;
 
+	/**
+	 * Fill `size` bytes at physical address `dst` with `value`
+	 */
+	virtual void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size) = 0;
+
+	/**
+	 * Copy `size` bytes between two dataspaces. The driver resolves the
+	 * physical addresses and keeps them until the session is closed or
+	 * `invalidate` is called.
+	 */
+	virtual void copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+			  Genode::Dataspace_capability src, Genode::off_t src_offset,
+			  Genode::size_t size) = 0;
+
+	/**
+	 * Forget the physical address of `ds`, which has to be called before a
+	 * dataspace used by `copy` is freed
+	 */
+	virtual void invalidate(Genode::Dataspace_capability ds) = 0;
+
+	/**
+	 * Copy `size` bytes at physical address `src` to all destinations in a
+	 * single submission, e.g. to a checkpoint image and its replica
+	 */
+	virtual void fanout(Cdma::Destinations dst, Genode::addr_t src, Genode::size_t size) = 0;
+
+	/**
+	 * Copy a strided region with a single descriptor chain, one descriptor
+	 * per row. After a failure, `failed_range()` holds the first row which
+	 * did not complete and the number of rows from there on.
+	 */
+	virtual void stride(Cdma::Stride stride) = 0;
+
+	/**
+	 * Dataspace containing a `Cdma::Batch`, which is filled by the client
+	 * before calling `batch`
+	 */
+	virtual Genode::Dataspace_capability batch_dataspace() = 0;
+
+	/**
+	 * Run the first `count` copies of the batch dataspace with a single
+	 * descriptor chain. After a failure, `failed_range()` holds the index of
+	 * the first copy which did not complete and the number of copies from
+	 * there on.
+	 */
+	virtual void batch(unsigned count) = 0;
+
+	/**
+	 * Range of the last failed `memcpy`, which was not copied. Everything
+	 * outside of this range was copied successfully.
+	 */
+	virtual Cdma::Range failed_range() = 0;
+
+	/**
+	 * Dataspace containing a `Cdma::Progress` cursor, which is updated
+	 * during `memcpy`. Other threads of the client can follow the cursor in
+	 * order to process the copied part while the copy is in progress.
+	 */
+	virtual Genode::Dataspace_capability progress_dataspace() = 0;
+
+	/**
+	 * Update the progress cursor every `descriptors` completed descriptors
+	 * or chunks. `0` (default) only updates it after a complete transfer.
+	 * In scather gather mode, the cursor moves with the interrupts of a
+	 * chain, thus an interval above 255 descriptors is clamped to 255.
+	 */
+	virtual void progress_interval(unsigned descriptors) = 0;
+
+	/**
+	 * Transfer limits of the CDMA and the crossover size below which a
+	 * copy by the CPU is faster
+	 */
+	virtual Cdma::Limits limits() = 0;
+
 	/*******************
 	 ** RPC interface **
 	 *******************/
@@ -39,16 +140,117 @@ struct Cdma::Session : Genode::Session
 			 memcpy,
 			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
 					  Cdma::Internal_memcpy_error,
-					  Cdma::Invalid_memcpy_address),
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
 			 Genode::addr_t,
 			 Genode::addr_t,
 			 Genode::size_t);
     
+	GENODE_RPC_THROW(Rpc_cdma_memset,
+			 void,
+			 memset,
+			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
+					  Cdma::Internal_memcpy_error,
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
+			 Genode::addr_t,
+			 Genode::uint8_t,
+			 Genode::size_t);
+
+	GENODE_RPC_THROW(Rpc_cdma_copy,
+			 void,
+			 copy,
+			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
+					  Cdma::Internal_memcpy_error,
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
+			 Genode::Dataspace_capability,
+			 Genode::off_t,
+			 Genode::Dataspace_capability,
+			 Genode::off_t,
+			 Genode::size_t);
+
+	GENODE_RPC(Rpc_cdma_invalidate,
+		   void,
+		   invalidate,
+		   Genode::Dataspace_capability);
+
+	GENODE_RPC_THROW(Rpc_cdma_fanout,
+			 void,
+			 fanout,
+			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
+					  Cdma::Internal_memcpy_error,
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
+			 Cdma::Destinations,
+			 Genode::addr_t,
+			 Genode::size_t);
+
+	GENODE_RPC_THROW(Rpc_cdma_stride,
+			 void,
+			 stride,
+			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
+					  Cdma::Internal_memcpy_error,
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
+			 Cdma::Stride);
+
+	GENODE_RPC(Rpc_cdma_batch_dataspace,
+		   Genode::Dataspace_capability,
+		   batch_dataspace);
+
+	GENODE_RPC_THROW(Rpc_cdma_batch,
+			 void,
+			 batch,
+			 GENODE_TYPE_LIST(Cdma::Function_unsupported,
+					  Cdma::Internal_memcpy_error,
+					  Cdma::Invalid_memcpy_address,
+					  Cdma::Memcpy_timeout,
+					  Cdma::Session_busy),
+			 unsigned);
+
+	GENODE_RPC(Rpc_cdma_completion_sigh,
+		   void,
+		   completion_sigh,
+		   Genode::Signal_context_capability);
+
+	GENODE_RPC(Rpc_cdma_result,
+		   Cdma::Status,
+		   result);
+
 	GENODE_RPC(Rpc_cdma_is_supported,
 		   bool,
 		   is_supported);
 
-	GENODE_RPC_INTERFACE(Rpc_cdma_memcpy, Rpc_cdma_is_supported);
+	GENODE_RPC(Rpc_cdma_failed_range,
+		   Cdma::Range,
+		   failed_range);
+
+	GENODE_RPC(Rpc_cdma_progress_dataspace,
+		   Genode::Dataspace_capability,
+		   progress_dataspace);
+
+	GENODE_RPC(Rpc_cdma_progress_interval,
+		   void,
+		   progress_interval,
+		   unsigned);
+
+	GENODE_RPC(Rpc_cdma_limits,
+		   Cdma::Limits,
+		   limits);
+
+	GENODE_RPC_INTERFACE(Rpc_cdma_memcpy, Rpc_cdma_memset,
+			     Rpc_cdma_is_supported, Rpc_cdma_failed_range,
+			     Rpc_cdma_progress_dataspace, Rpc_cdma_progress_interval,
+			     Rpc_cdma_limits, Rpc_cdma_fanout,
+			     Rpc_cdma_batch_dataspace, Rpc_cdma_batch,
+			     Rpc_cdma_stride, Rpc_cdma_copy, Rpc_cdma_invalidate,
+			     Rpc_cdma_completion_sigh, Rpc_cdma_result);
 };
 
 
@@ -11,6 +11,8 @@
 #include <base/rpc_client.h>
 #include <base/log.h>
 #include <base/stdint.h>
+#include <base/signal.h>
+#include <base/lock.h>
 
 namespace Cdma {
     struct Session_client;
@@ -18,18 +20,113 @@ namespace Cdma {
 
 struct Cdma::Session_client : Genode::Rpc_client<Session>
 {
+private:
+
+    // threads of the client share the session, thus only one of them
+    // waits for a completion at a time
+    Genode::Lock _lock;
+    Genode::Signal_receiver _receiver;
+    Genode::Signal_context _completion;
+
+    /**
+     * Submit a transfer by `submit_fn` and block until it completes.
+     */
+    template <typename FN>
+    void _transfer(FN const &submit_fn)
+    {
+        Genode::Lock::Guard guard(_lock);
+        submit_fn();
+        _receiver.wait_for_signal();
+
+        switch(call<Rpc_cdma_result>())
+        {
+        case SUCCESS:
+        case PENDING:                break;
+        case FUNCTION_UNSUPPORTED:   throw Cdma::Function_unsupported();
+        case INVALID_MEMCPY_ADDRESS: throw Cdma::Invalid_memcpy_address();
+        case INTERNAL_MEMCPY_ERROR:  throw Cdma::Internal_memcpy_error();
+        case MEMCPY_TIMEOUT:         throw Cdma::Memcpy_timeout();
+        }
+    }
+
+public:
   
 	Session_client(Genode::Capability<Session> cap)
-    : Genode::Rpc_client<Session>(cap) { }
+    : Genode::Rpc_client<Session>(cap)
+    {
+        completion_sigh(_receiver.manage(&_completion));
+    }
+
+    ~Session_client()
+    {
+        _receiver.dissolve(&_completion);
+    }
   
+    void completion_sigh(Genode::Signal_context_capability sigh) {
+        call<Rpc_cdma_completion_sigh>(sigh);
+    }
+
+    Cdma::Status result() {
+        return call<Rpc_cdma_result>();
+    }
   
     void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size) {
-        call<Rpc_cdma_memcpy>(dst, src, size);
+        _transfer([&] () { call<Rpc_cdma_memcpy>(dst, src, size); });
+    }
+
+    void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size) {
+        _transfer([&] () { call<Rpc_cdma_memset>(dst, value, size); });
+    }
+
+    void copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+              Genode::Dataspace_capability src, Genode::off_t src_offset,
+              Genode::size_t size) {
+        _transfer([&] () { call<Rpc_cdma_copy>(dst, dst_offset, src, src_offset, size); });
+    }
+
+    void invalidate(Genode::Dataspace_capability ds) {
+        call<Rpc_cdma_invalidate>(ds);
+    }
+
+    void fanout(Cdma::Destinations dst, Genode::addr_t src, Genode::size_t size) {
+        _transfer([&] () { call<Rpc_cdma_fanout>(dst, src, size); });
+    }
+
+    void stride(Cdma::Stride stride) {
+        _transfer([&] () { call<Rpc_cdma_stride>(stride); });
+    }
+
+    Genode::Dataspace_capability batch_dataspace() {
+        return call<Rpc_cdma_batch_dataspace>();
+    }
+
+    void batch(unsigned count) {
+        _transfer([&] () { call<Rpc_cdma_batch>(count); });
+    }
+
+    void zero(Genode::addr_t dst, Genode::size_t size) {
+        memset(dst, 0, size);
     }
 
     bool is_supported() {
         return call<Rpc_cdma_is_supported>();
     }
+
+    Genode::Dataspace_capability progress_dataspace() {
+        return call<Rpc_cdma_progress_dataspace>();
+    }
+
+    void progress_interval(unsigned descriptors) {
+        call<Rpc_cdma_progress_interval>(descriptors);
+    }
+
+    Cdma::Range failed_range() {
+        return call<Rpc_cdma_failed_range>();
+    }
+
+    Cdma::Limits limits() {
+        return call<Rpc_cdma_limits>();
+    }
   
 };
 
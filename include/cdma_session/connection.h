@@ -16,9 +16,20 @@ namespace Cdma {
 
 struct Cdma::Connection : Genode::Connection<Session>, Session_client
 {
-	Connection(Genode::Env &env)
+	/**
+	 * @param bandwidth Maximum bytes per second consumed by the transfers of
+	 * this session, `0` applies the limit of the driver configuration
+	 *
+	 * @param duty Percentage of time the CDMA may be busy with transfers of
+	 * this session
+	 */
+	Connection(Genode::Env &env, Genode::size_t bandwidth = 0, unsigned duty = 100)
 	:
-		Genode::Connection<Session>(env, session(env.parent(), "ram_quota=8K")),
+		Genode::Connection<Session>(env, session(env.parent(),
+		                                         "ram_quota=%u, cap_quota=%u, "
+		                                         "bandwidth=%lu, duty=%u",
+		                                         (unsigned)RAM_QUOTA, (unsigned)CAP_QUOTA,
+		                                         bandwidth, duty)),
 		Session_client(cap()) { }
 };
 
@@ -0,0 +1,105 @@
+/*
+ * \brief  CDMA session shared by all intercepting pd sessions
+ * \author Johannes Fischer
+ * \date   2019-10-16
+ */
+
+#ifndef _RTCR_CDMA_BACKEND_H_
+#define _RTCR_CDMA_BACKEND_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <base/lock.h>
+#include <base/attached_dataspace.h>
+#include <util/reconstructible.h>
+#include <cdma_session/connection.h>
+#include <cdma/local_session.h>
+#include <cdma/soft_session.h>
+
+namespace Rtcr {
+	class Cdma_backend;
+}
+
+
+/**
+ * Opening a `Cdma::Connection` per pd session costs a session request and
+ * quota for every started child. Instead, the module opens one CDMA session
+ * when it starts and all pd sessions share it. The session is a connection
+ * to `cdma_drv`, a session of the linked driver or, if the CDMA is missing,
+ * the software engine.
+ */
+class Rtcr::Cdma_backend
+{
+private:
+	Genode::Constructible<Cdma::Connection> _connection;
+	Genode::Constructible<Cdma::Local_session> _local;
+	Genode::Constructible<Cdma::Soft_session> _soft;
+
+	Cdma::Session &_session;
+	Cdma::Limits const _limits;
+
+	/* serializes a transfer and the query of its failed range */
+	Genode::Lock _lock;
+	Genode::Attached_dataspace _batch;
+
+	Cdma_backend(Genode::Env &env, Genode::Allocator &alloc);
+
+	Cdma::Session &_open(Genode::Env &env, Genode::Allocator &alloc);
+
+public:
+	/**
+	 * Backend shared by all intercepting pd sessions. It is created by
+	 * `Cdma_module` after the configuration is applied.
+	 */
+	static Cdma_backend &factory(Genode::Env &env, Genode::Allocator &alloc);
+
+	/**
+	 * Backend of a session, which is opened by the caller, e.g. by a test
+	 */
+	Cdma_backend(Genode::Env &env, Cdma::Session &session)
+		:
+		_session(session),
+		_limits(_session.limits()),
+		_batch(env.rm(), _session.batch_dataspace())
+	{ }
+
+	/**
+	 * Limits of the CDMA, which are queried once
+	 */
+	Cdma::Limits const &limits() const { return _limits; }
+
+	/**
+	 * Run `fn(session, batch)` exclusively. Every call of the session has to
+	 * be done inside of `fn`, because any call between a failed transfer
+	 * and the read of its `failed_range` resets the range.
+	 */
+	template <typename FN>
+	void apply(FN const &fn)
+	{
+		Genode::Lock::Guard guard(_lock);
+		fn(_session, *_batch.local_addr<Cdma::Batch>());
+	}
+
+	/**
+	 * Make a dataspace known to the physical-address transfers of the
+	 * software engine
+	 */
+	void attach(Genode::Dataspace_capability ds)
+	{
+		if(_soft.constructed())
+			_soft->attach(ds);
+	}
+
+	/**
+	 * Undo an `attach`, which has to be done before `ds` is freed. The
+	 * software engine keeps a local mapping of an attached dataspace.
+	 */
+	void detach(Genode::Dataspace_capability ds)
+	{
+		if(_soft.constructed())
+			_soft->detach(ds);
+	}
+};
+
+#endif /* _RTCR_CDMA_BACKEND_H_ */
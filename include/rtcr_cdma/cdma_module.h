@@ -11,6 +11,7 @@
 #include <base/heap.h>
 #include <base/allocator.h>
 #include <base/service.h>
+#include <base/attached_rom_dataspace.h>
 
 
 /* Local includes */
@@ -28,6 +29,10 @@
 #include <rtcr/root_component.h>
 
 #include <rtcr_cdma/pd_session.h>
+#include <rtcr_cdma/copy_queue.h>
+#include <rtcr_cdma/dst_arena.h>
+#include <rtcr_cdma/trace.h>
+#include <rtcr_cdma/timing.h>
 
 namespace Rtcr {
 	class Cdma_module;
@@ -50,6 +55,16 @@ private:
 	Root_component<Timer_session> _timer;
 	Root_component<Rom_session> _rom;
 	Root_component<Rm_session> _rm;      
+	Cdma_copy_queue &_copy_queue;
+	Cdma_dst_arena &_dst_arena;
+	Cdma_trace &_trace;
+	Cdma_timing &_timing;
+	Genode::Attached_rom_dataspace _config;
+
+	/**
+	 * Apply the content of `<module name="cdma">`
+	 */
+	void _configure(Genode::Env &env, Genode::Xml_node module);
 public:	
 	Cdma_module(Genode::Env &env, Genode::Allocator &alloc);
 	
@@ -60,6 +75,23 @@ public:
 		return _pd.create(args, affinity);
 	}
 
+	/**
+	 * Ram dataspaces are copied asynchronously by the CDMA while the other
+	 * checkpointables run. The checkpoint is only complete, after all
+	 * transfers finished. With `<deadline us="..."/>`, the checkpoint is
+	 * admitted like by `checkpoint(deadline_us)`. A rejected checkpoint
+	 * is logged and leaves the previous checkpoint unchanged.
+	 */
+	void checkpoint() override;
+
+	/**
+	 * Checkpoint only, if the predicted copy time of all dataspaces fits
+	 * `deadline_us`. `0` admits every checkpoint.
+	 *
+	 * @return `False`, if the checkpoint is rejected
+	 */
+	bool checkpoint(Genode::uint64_t deadline_us);
+
 };
 
 #endif /* _RTCR_CDMA_MODULE_H_ */
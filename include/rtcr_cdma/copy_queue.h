@@ -0,0 +1,37 @@
+/*
+ * \brief  Asynchronous issuing of CDMA transfers
+ * \author Johannes Fischer
+ * \date   2019-09-10
+ */
+
+#ifndef _RTCR_CDMA_COPY_QUEUE_H_
+#define _RTCR_CDMA_COPY_QUEUE_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <cdma/job_queue.h>
+
+namespace Rtcr {
+	class Cdma_copy_queue;
+}
+
+
+/**
+ * A `Cdma::Session::memcpy` blocks the caller until the transfer is finished.
+ * The copy queue issues these transfers from its own thread, such that the
+ * checkpointing thread continues with the CPU-bound checkpointables while the
+ * CDMA copies the ram dataspaces.
+ */
+class Rtcr::Cdma_copy_queue : public Cdma::Job_queue
+{
+private:
+	Cdma_copy_queue(Genode::Env &env);
+
+public:
+	/**
+	 * Singleton queue shared by all intercepting pd sessions
+	 */
+	static Cdma_copy_queue &factory(Genode::Env &env);
+};
+
+#endif /* _RTCR_CDMA_COPY_QUEUE_H_ */
@@ -0,0 +1,65 @@
+/*
+ * \brief  CPU part of a hybrid CPU and CDMA copy
+ * \author Johannes Fischer
+ * \date   2019-10-01
+ */
+
+#ifndef _RTCR_CDMA_CPU_COPIER_H_
+#define _RTCR_CDMA_CPU_COPIER_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/thread.h>
+#include <base/semaphore.h>
+
+namespace Rtcr {
+	class Cdma_cpu_copier;
+}
+
+
+/**
+ * While the copy queue waits for the interrupt of the CDMA, a part of a large
+ * dataspace is copied by this thread. It runs on the last CPU of the affinity
+ * space, which is not used by the entrypoints of rtcr.
+ */
+class Rtcr::Cdma_cpu_copier : public Genode::Thread
+{
+private:
+	enum { STACK_SIZE = 16*1024 };
+
+	Genode::Semaphore _started;
+	Genode::Semaphore _finished;
+
+	void *_dst = nullptr;
+	void const *_src = nullptr;
+	Genode::size_t _size = 0;
+
+	Cdma_cpu_copier(Genode::Env &env);
+
+	void entry() override;
+
+public:
+	/**
+	 * Singleton copier shared by all intercepting pd sessions
+	 */
+	static Cdma_cpu_copier &factory(Genode::Env &env);
+
+	/**
+	 * Copy `size` bytes with the kernel of the software engine of the
+	 * CDMA library, which uses NEON if available
+	 */
+	static void copy(void *dst, void const *src, Genode::size_t size);
+
+	/**
+	 * Start copying in the background. Only one copy is in flight, thus
+	 * every `start` has to be followed by `wait`.
+	 */
+	void start(void *dst, void const *src, Genode::size_t size);
+
+	/**
+	 * Block until the started copy is finished
+	 */
+	void wait();
+};
+
+#endif /* _RTCR_CDMA_CPU_COPIER_H_ */
@@ -0,0 +1,132 @@
+/*
+ * \brief  Arena of destination dataspaces for checkpointed ram dataspaces
+ * \author Johannes Fischer
+ * \date   2019-09-12
+ */
+
+#ifndef _RTCR_CDMA_DST_ARENA_H_
+#define _RTCR_CDMA_DST_ARENA_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <base/exception.h>
+#include <base/lock.h>
+#include <base/cache.h>
+#include <util/list.h>
+#include <util/xml_node.h>
+
+namespace Rtcr {
+	class Cdma_dst_arena;
+}
+
+
+/**
+ * Released destination dataspaces are kept in a free list and are handed out
+ * again, instead of freeing and allocating them with a PD RPC. A request is
+ * served by the smallest free buffer, which wastes at most an eighth of the
+ * requested size. Otherwise, a buffer of the page-aligned size is allocated.
+ *
+ * A buffer holds the checkpoint of the child it was handed out to. Before it
+ * is handed out to another child, it is zeroed by the CPU, unless it was
+ * scrubbed on release.
+ */
+class Rtcr::Cdma_dst_arena
+{
+public:
+	/* identifies the child, whose checkpoint is written to a buffer */
+	typedef unsigned long Owner;
+
+	struct Buffer : Genode::List<Buffer>::Element {
+		Genode::Ram_dataspace_capability cap;
+		Genode::size_t size;
+		Genode::Cache_attribute cached;
+		Genode::addr_t phys_addr;
+		Owner owner = 0;
+
+		/* the content is all zero, because the buffer is freshly
+		 * allocated or was scrubbed */
+		bool zeroed = true;
+
+		Buffer(Genode::Ram_dataspace_capability _cap, Genode::size_t _size,
+		       Genode::Cache_attribute _cached, Genode::addr_t _phys_addr)
+			: cap(_cap), size(_size), cached(_cached), phys_addr(_phys_addr) {}
+	};
+
+	struct Invalid_size : Genode::Exception { };
+
+private:
+	enum {
+		PAGE_SIZE_LOG2 = 12,
+		NUM_ATTRIBUTES = Genode::CACHED + 1,
+
+		/* a free buffer serves a request, if it is larger by at most
+		 * 1/2^MAX_WASTE_SHIFT of the requested size */
+		MAX_WASTE_SHIFT = 3,
+	};
+
+	Genode::Env       &_env;
+	Genode::Allocator &_alloc;
+	Genode::Lock       _lock;
+
+	/* sorted by size */
+	Genode::List<Buffer> _free[NUM_ATTRIBUTES];
+
+	/* number of unused buffers kept per size */
+	unsigned _max_free = 8;
+
+	Owner _last_owner = 0;
+
+	Cdma_dst_arena(Genode::Env &env, Genode::Allocator &alloc);
+
+	static Genode::size_t _aligned(Genode::size_t size);
+
+	Buffer &_alloc_buffer(Genode::size_t size, Genode::Cache_attribute cached);
+	void _free_buffer(Buffer &buffer);
+
+	/**
+	 * Insert a buffer into its free list, or free it if `max_free` buffers
+	 * of its size are kept already
+	 */
+	void _insert(Buffer &buffer, unsigned max_free);
+
+	void _zero(Buffer &buffer);
+
+public:
+	/**
+	 * Singleton arena shared by all intercepting pd sessions
+	 */
+	static Cdma_dst_arena &factory(Genode::Env &env, Genode::Allocator &alloc);
+
+	/**
+	 * Apply `<arena>` configuration node
+	 *
+	 * Example: `<arena max_free="8"> <reserve size="1M" count="4"/> </arena>`
+	 */
+	void configure(Genode::Xml_node arena);
+
+	/**
+	 * Pre-allocate `count` buffers which can hold `size` bytes
+	 */
+	void reserve(Genode::size_t size, Genode::Cache_attribute cached, unsigned count);
+
+	/**
+	 * Identifier of a new child, which is passed to `acquire`
+	 */
+	Owner new_owner();
+
+	/**
+	 * Hand out a buffer of at least `size` bytes to `owner`. A buffer, which
+	 * holds the data of another owner, is zeroed before.
+	 *
+	 * @exception Invalid_size  `size` is zero
+	 */
+	Buffer &acquire(Genode::size_t size, Genode::Cache_attribute cached, Owner owner);
+
+	/**
+	 * Return a buffer to the arena
+	 */
+	void release(Buffer &buffer);
+};
+
+#endif /* _RTCR_CDMA_DST_ARENA_H_ */
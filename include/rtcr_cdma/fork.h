@@ -0,0 +1,77 @@
+/*
+ * \brief  Batched copy of the dataspaces of a forked child
+ * \author Johannes Fischer
+ * \date   2019-10-09
+ */
+
+#ifndef _RTCR_CDMA_FORK_H_
+#define _RTCR_CDMA_FORK_H_
+
+/* Genode includes */
+#include <region_map/region_map.h>
+#include <cdma_session/cdma_session.h>
+
+namespace Rtcr {
+	class Cdma_fork;
+}
+
+
+/**
+ * Collects the copies from the checkpoint images of a running child to the
+ * dataspaces of a new child, which is forked from it. All copies are run by
+ * one descriptor chain, the copies which did not complete by the CPU.
+ */
+class Rtcr::Cdma_fork
+{
+private:
+	struct Entry {
+		Genode::Ram_dataspace_capability dst;
+		Genode::Ram_dataspace_capability src;
+		Cdma::Copy copy;
+	};
+
+	Genode::Region_map &_rm;
+
+	Entry _entries[Cdma::Batch::MAX];
+	unsigned _count = 0;
+
+public:
+	Cdma_fork(Genode::Region_map &rm) : _rm(rm) {}
+
+	bool empty() const { return !_count; }
+	bool full()  const { return _count == Cdma::Batch::MAX; }
+
+	/**
+	 * Copy `size` bytes of `src` at physical address `src_addr` to `dst` at
+	 * physical address `dst_addr`. The fork must not be full.
+	 */
+	void add(Genode::Ram_dataspace_capability dst, Genode::addr_t dst_addr,
+		 Genode::Ram_dataspace_capability src, Genode::addr_t src_addr,
+		 Genode::size_t size);
+
+	/**
+	 * Call `fn(dst)` for the destination of every collected copy
+	 */
+	template <typename FN>
+	void for_each_target(FN const &fn) const
+	{
+		for(unsigned i = 0; i < _count; i++)
+			fn(_entries[i].dst);
+	}
+
+	/**
+	 * Run the collected copies by one batch. A shared session has to be
+	 * held by the caller.
+	 *
+	 * @return Index of the first copy which did not complete
+	 */
+	unsigned submit(Cdma::Session &cdma, Cdma::Batch &batch);
+
+	/**
+	 * Copy the collected copies from index `first_failed` on by the CPU
+	 * and clear the fork
+	 */
+	void complete(unsigned first_failed);
+};
+
+#endif /* _RTCR_CDMA_FORK_H_ */
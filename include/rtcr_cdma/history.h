@@ -0,0 +1,96 @@
+/*
+ * \brief  Checkpoint history of a ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-09-16
+ */
+
+#ifndef _RTCR_CDMA_HISTORY_H_
+#define _RTCR_CDMA_HISTORY_H_
+
+/* Genode includes */
+#include <base/allocator.h>
+#include <util/list.h>
+
+namespace Rtcr {
+	class Cdma_history;
+}
+
+
+/**
+ * The newest checkpoint of a dataspace is stored as full image in the
+ * destination dataspace. Every older generation only stores the pages which
+ * were overwritten by its successor (reverse delta). Therefore the memory
+ * consumption grows with the number of modified pages and not with the
+ * depth of the history.
+ *
+ * The pages of a generation are stored in one buffer. The generations of a
+ * history consume at most `budget` bytes, older generations are dropped
+ * first.
+ */
+class Rtcr::Cdma_history
+{
+public:
+	enum { PAGE_SIZE = 4096 };
+
+private:
+	/* followed by `count` page indices and `count` pages */
+	struct Generation : Genode::List<Generation>::Element {
+		Genode::size_t const count;
+
+		Generation(Genode::size_t _count) : count(_count) {}
+
+		static Genode::size_t bytes(Genode::size_t count) {
+			return sizeof(Generation) + count*(sizeof(Genode::size_t) + PAGE_SIZE); }
+
+		Genode::size_t *index() { return (Genode::size_t *)(this + 1); }
+		char *data() { return (char *)(index() + count); }
+	};
+
+	Genode::Allocator &_alloc;
+	unsigned const _depth;
+	Genode::size_t const _budget;
+
+	/* newest generation first */
+	Genode::List<Generation> _generations;
+	unsigned _count = 0;
+	Genode::size_t _bytes = 0;
+
+	/* indices of the modified pages while recording, one per page */
+	Genode::size_t *_modified = nullptr;
+	Genode::size_t _pages = 0;
+
+	void _drop_oldest();
+
+public:
+	/**
+	 * @param depth  Number of checkpoints including the full image
+	 * @param budget Maximum number of bytes of the older generations
+	 */
+	Cdma_history(Genode::Allocator &alloc, unsigned depth, Genode::size_t budget)
+		: _alloc(alloc), _depth(depth), _budget(budget) {}
+
+	~Cdma_history();
+
+	/**
+	 * Store the pages of `image` which differ from `next` as new generation.
+	 * Has to be called before `image` is overwritten by `next`. The oldest
+	 * generations are dropped, if the history is full or exceeds its
+	 * budget. A generation larger than the budget empties the history.
+	 */
+	void record(void const *image, void const *next, Genode::size_t size);
+
+	/**
+	 * Rewind `image` by `generations` checkpoints. The rewound generations
+	 * are removed from the history.
+	 *
+	 * @return `False`, if the history holds less generations
+	 */
+	bool rollback(void *image, unsigned generations);
+
+	/**
+	 * Number of stored older generations
+	 */
+	unsigned count() const { return _count; }
+};
+
+#endif /* _RTCR_CDMA_HISTORY_H_ */
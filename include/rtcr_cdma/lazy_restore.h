@@ -0,0 +1,166 @@
+/*
+ * \brief  On-demand restore of a ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-09-19
+ */
+
+#ifndef _RTCR_CDMA_LAZY_RESTORE_H_
+#define _RTCR_CDMA_LAZY_RESTORE_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <base/lock.h>
+#include <base/signal.h>
+#include <base/semaphore.h>
+#include <base/entrypoint.h>
+#include <rm_session/connection.h>
+#include <region_map/client.h>
+
+/* Local includes */
+#include <rtcr_cdma/backend.h>
+#include <rtcr_cdma/copy_queue.h>
+#include <rtcr_cdma/zero_map.h>
+
+namespace Rtcr {
+	class Cdma_lazy_restore;
+}
+
+
+/**
+ * Instead of copying a checkpointed dataspace back before the child resumes,
+ * the child gets a managed dataspace which is empty at first. A page fault
+ * in this dataspace copies the faulting window from the checkpoint into the
+ * target dataspace with the CDMA and attaches the window. Meanwhile, a
+ * background job on the copy queue fills in all windows which were not
+ * touched yet. A window, which the CDMA fails to copy, is copied by the CPU.
+ *
+ * The faults are handled by an entrypoint of the lazy restores, such that a
+ * transfer never blocks the entrypoint of the intercepting sessions. The
+ * lock of the windows is not held during a transfer.
+ *
+ * The managed dataspace stays attached to the child after the restore is
+ * complete, thus the restore lives as long as the restored dataspace. Only
+ * the state of the windows is freed after the sweep.
+ */
+class Rtcr::Cdma_lazy_restore : public Genode::List<Cdma_lazy_restore>::Element
+{
+public:
+	/**
+	 * The target has no physical address, which the CDMA can write, or is
+	 * smaller than the checkpoint
+	 */
+	struct Unsupported_target : Genode::Exception { };
+
+private:
+	struct Sweep : Cdma_copy_queue::Job {
+		Cdma_lazy_restore &restore;
+		Sweep(Cdma_lazy_restore &_restore) : restore(_restore) {}
+		void execute() override { restore._sweep(); }
+	};
+
+	enum Window_state : Genode::uint8_t { EMPTY, FILLING, PRESENT };
+
+	Genode::Region_map &_local_rm;
+	Genode::Allocator &_alloc;
+	Cdma_backend &_backend;
+	Cdma_copy_queue &_copy_queue;
+
+	Genode::Ram_dataspace_capability const _checkpoint;
+	Genode::addr_t const _checkpoint_addr;
+	Genode::Ram_dataspace_capability const _target;
+	Genode::addr_t const _target_addr;
+	Genode::size_t const _size;
+	Genode::size_t const _window;
+	Genode::size_t const _windows;
+
+	/* zero pages of the checkpoint, which are set instead of copied */
+	Cdma_zero_map const *_zero_map;
+
+	/* state of the windows, freed after the last window is attached */
+	Genode::Lock _lock;
+	Genode::uint8_t *_state;
+	Genode::size_t _remaining;
+
+	/* faults waiting for a window, which is filled by the sweep */
+	Genode::Semaphore _filled;
+	unsigned _waiters = 0;
+
+	Genode::Rm_connection _rm;
+	Genode::Region_map_client _map;
+	Genode::Signal_handler<Cdma_lazy_restore> _fault_handler;
+	Sweep _sweep_job { *this };
+
+	static Genode::addr_t _checked_addr(Genode::Ram_dataspace_capability target,
+					    Genode::size_t size);
+
+	/**
+	 * Reserve a window for the calling thread
+	 *
+	 * @param wait  Wait for a window, which is filled by another thread
+	 *
+	 * @return `False`, if the window is attached or filled by another
+	 *         thread
+	 */
+	bool _claim(Genode::size_t window, bool wait);
+
+	/**
+	 * Copy and attach a claimed window
+	 */
+	void _fill(Genode::size_t window);
+
+	void _copy_by_cpu(Genode::off_t offset, Genode::size_t size, bool zero);
+
+	void _handle_fault();
+	void _sweep();
+
+public:
+	/**
+	 * Entrypoint, which handles the faults of all lazy restores
+	 */
+	static Genode::Entrypoint &entrypoint(Genode::Env &env);
+
+	/**
+	 * @param checkpoint       Checkpointed dataspace, which is read by the
+	 *                         CPU if a transfer fails
+	 *
+	 * @param checkpoint_addr  Physical address of `checkpoint`
+	 *
+	 * @param target Uncached and physically contiguous dataspace, which is
+	 *               filled with the checkpoint
+	 *
+	 * @param window Bytes copied per page fault, multiple of the page size
+	 *
+	 * @param zero_map Zero pages of the checkpoint, if it is sparse
+	 *
+	 * @exception Unsupported_target
+	 */
+	Cdma_lazy_restore(Genode::Env &env,
+			  Genode::Entrypoint &ep,
+			  Genode::Allocator &alloc,
+			  Cdma_backend &backend,
+			  Cdma_copy_queue &copy_queue,
+			  Genode::Ram_dataspace_capability checkpoint,
+			  Genode::addr_t checkpoint_addr,
+			  Genode::Ram_dataspace_capability target,
+			  Genode::size_t size,
+			  Genode::size_t window,
+			  Cdma_zero_map const *zero_map = nullptr);
+
+	~Cdma_lazy_restore();
+
+	/**
+	 * Managed dataspace which is attached to the region maps of the child
+	 * instead of `target`
+	 */
+	Genode::Dataspace_capability dataspace() { return _map.dataspace(); }
+
+	Genode::Ram_dataspace_capability target() const { return _target; }
+
+	/**
+	 * `True`, if the complete checkpoint is copied to the target
+	 */
+	bool complete();
+};
+
+#endif /* _RTCR_CDMA_LAZY_RESTORE_H_ */
@@ -7,11 +7,22 @@
 #ifndef _RTCR_PD_CDMA_SESSION_H_
 #define _RTCR_PD_CDMA_SESSION_H_
 
-/* Genode includes */
-
 /* Rtcr includes */
 #include <rtcr/pd/pd_session.h>
-#include <cdma_session/connection.h>
+#include <cdma/driver.h>
+
+/* Local includes */
+#include <rtcr_cdma/backend.h>
+#include <rtcr_cdma/copy_queue.h>
+#include <rtcr_cdma/dst_arena.h>
+#include <rtcr_cdma/fork.h>
+#include <rtcr_cdma/history.h>
+#include <rtcr_cdma/lazy_restore.h>
+#include <rtcr_cdma/cpu_copier.h>
+#include <rtcr_cdma/prefault.h>
+#include <rtcr_cdma/trace.h>
+#include <rtcr_cdma/timing.h>
+#include <rtcr_cdma/zero_map.h>
 
 namespace Rtcr {
 	class Pd_cdma_session;
@@ -21,17 +32,196 @@ namespace Rtcr {
 
 class Rtcr::Pd_cdma_session : public Rtcr::Pd_session
 {
+public:
+	/* options of `<module name="cdma">`, shared by all sessions */
+	struct Config {
+		/* number of kept checkpoints per dataspace, see `<history>` */
+		unsigned history_depth = 1;
+
+		/* bytes of the older generations per dataspace, `0` limits them
+		 * to the size of the dataspace */
+		Genode::size_t history_budget = 0;
+
+		/* bytes copied per page fault of a lazy restore, `0` disables it */
+		Genode::size_t restore_window = 0;
+
+		/* zero uncached destinations with the CDMA before they are
+		 * recycled by the arena. Otherwise, the arena zeroes them by the
+		 * CPU, when they are handed out to another child. */
+		bool scrub = false;
+
+		/* uncached dataspaces of at least this size are split into a CDMA
+		 * and a CPU part, `0` disables it. Requires a calibrated driver. */
+		Genode::size_t hybrid_min = 0;
+
+		/* map restored dataspaces eagerly, see `<prefault>` */
+		bool prefault = false;
+
+		/* only map the pages written between the last two checkpoints */
+		bool prefault_hot = false;
+
+		/* write uncached checkpoints to a second destination, see
+		 * `<replica/>` */
+		bool replica = false;
+
+		/* driver of the CDMA IP core, if rtcr is its only user and drives
+		 * it itself, see `<driver>`. Otherwise the sessions connect to
+		 * `cdma_drv`. */
+		Cdma::Driver *driver = nullptr;
+
+		/* copy by the software engine without trying the CDMA, see
+		 * `<software>` */
+		bool software = false;
+
+		/* threads of the software engine, `0` uses all CPUs */
+		unsigned software_threads = 0;
+
+		/* uncached dataspaces of at least this size are scanned for zero
+		 * pages, which are not copied, see `<sparse>`. `0` disables it. */
+		Genode::size_t sparse_min = 0;
+	};
+
+	static Config &config()
+	{
+		static Config config;
+		return config;
+	}
+
 private:
-	Cdma::Connection _cdma_drv;
-	
-	struct Physical_address {
+	/* CDMA session, which is shared with all pd sessions */
+	Cdma_backend &_backend;
+	Cdma_copy_queue &_copy_queue;
+	Cdma_dst_arena &_dst_arena;
+
+	/* recycled destinations of other children are zeroed on acquire */
+	Cdma_dst_arena::Owner const _arena_owner;
+
+	Cdma_cpu_copier &_cpu_copier;
+	Cdma_trace &_trace;
+	Cdma_timing &_timing;
+
+	/* uncached dataspaces below the crossover are copied by the CPU */
+	Cdma::Limits const &_limits;
+
+	/* destination buffer and pending copy of a dataspace, stored in
+	 * `Ram_dataspace::storage` */
+	struct Copy_job : Cdma_copy_queue::Job {
+		Pd_cdma_session &session;
+		Ram_dataspace *ds;
+		Cdma_dst_arena::Buffer &dst;
 		Genode::addr_t dst_addr;
 		Genode::addr_t src_addr;
-		
-		Physical_address(Genode::addr_t _dst_addr, Genode::addr_t _src_addr)
-			: dst_addr(_dst_addr), src_addr(_src_addr) {}
+		Cdma_history *history = nullptr;
+		Cdma_working_set *working_set = nullptr;
+		Cdma_zero_map *zero_map = nullptr;
+		Cdma_dst_arena::Buffer *replica = nullptr;
+		Cdma_lazy_restore *restore = nullptr;
+		bool checkpointed = false;
+		Genode::List_element<Copy_job> elem { this };
+
+		Copy_job(Pd_cdma_session &_session, Ram_dataspace *_ds,
+			 Cdma_dst_arena::Buffer &_dst, Genode::addr_t _src_addr)
+			: session(_session), ds(_ds), dst(_dst),
+			  dst_addr(_dst.phys_addr), src_addr(_src_addr) {}
+
+		void execute() override { session._dma_copy(*this); }
 	};
 
+	/* dataspaces which are restored on demand, at most one per dataspace */
+	Genode::List<Cdma_lazy_restore> _lazy_restores;
+
+	/**
+	 * Destroy the lazy restore of `job`, if any
+	 */
+	void _destroy_restore(Copy_job &job);
+
+	/* all dataspaces with a destination */
+	Genode::List<Genode::List_element<Copy_job> > _jobs;
+	Genode::Lock _jobs_lock;
+
+	/* allocated dataspaces, which were not checkpointed yet, thus have no
+	 * `Copy_job`. They are copied by the next checkpoint and predicted
+	 * alike. Protected by `_jobs_lock`. */
+	typedef Genode::List_element<Ram_dataspace> Unattached;
+	Genode::List<Unattached> _unattached;
+
+	/**
+	 * Remove `ds` from `_unattached`, if it is listed
+	 */
+	void _remove_unattached(Ram_dataspace *ds);
+
+	/* all sessions, whose checkpoints are predicted by `predict_all` */
+	typedef Genode::List<Genode::List_element<Pd_cdma_session> > Sessions;
+	Genode::List_element<Pd_cdma_session> _session_elem { this };
+
+	static Sessions &_sessions()
+	{
+		static Sessions sessions;
+		return sessions;
+	}
+
+	static Genode::Lock &_sessions_lock()
+	{
+		static Genode::Lock lock;
+		return lock;
+	}
+
+	/* restored ranges which are mapped before the child resumes */
+	Cdma_prefault _prefault { _md_alloc };
+
+	/* dataspaces of a forked child, which are copied by one batch. The
+	 * batch of the shared session is only filled by `fork_commit`. */
+	Cdma_fork _fork { _env.rm() };
+
+	/**
+	 * Copy `size` bytes between two dataspaces by the CPU
+	 */
+	void _cpu_copy(Genode::Ram_dataspace_capability dst,
+		       Genode::Ram_dataspace_capability src, Genode::size_t size);
+
+	/**
+	 * Store the pages of the last checkpoint, which are going to be
+	 * overwritten, in the history of the dataspace and mark them as
+	 * working set. Reads the image and the dataspace by the CPU, thus it is
+	 * called by the submitting thread and not by the copy queue.
+	 */
+	void _record_history(Copy_job &job);
+
+	/**
+	 * Copy with the CDMA, executed by the thread of the copy queue. If the
+	 * transfer fails, the dataspace is copied by the CPU.
+	 */
+	void _dma_copy(Copy_job &job);
+
+	/**
+	 * Number of bytes at the end of a dataspace of `size` bytes, which are
+	 * copied by the CPU while the CDMA copies the rest. The parts are sized
+	 * by the calibrated throughputs, such that both finish at the same time.
+	 */
+	Genode::size_t _cpu_part(Genode::size_t size);
+
+	/**
+	 * Copy only the non-zero pages of a dataspace with `Cdma_zero_map` by
+	 * batches of the CDMA. Failed copies are done by the CPU.
+	 */
+	void _sparse_copy(Copy_job &job);
+
+	/**
+	 * Mode of the timing model, by which `job` is copied
+	 */
+	Cdma_timing::Mode _mode(Copy_job const &job);
+
+	/**
+	 * Mode of the timing model, by which the first copy of `ds` without a
+	 * `Copy_job` is predicted
+	 */
+	Cdma_timing::Mode _mode(Ram_dataspace const &ds);
+
+	/**
+	 * Flags of `job` for `Cdma_trace::record`
+	 */
+	unsigned _trace_flags(Copy_job const &job) const;
+
 protected:
 	
 	void _copy_dataspace(Ram_dataspace *info) override;
@@ -45,7 +235,84 @@ public:
 			Genode::Entrypoint &ep,
 			const char *creation_args,
 			Child_info *child_info);
-	
+
+	~Pd_cdma_session();
+
+	/**
+	 * Rewind the checkpointed dataspaces of this session by `generations`
+	 * checkpoints. Requires `<history depth="..."/>`.
+	 *
+	 * @return `False`, if a dataspace has not enough generations stored.
+	 *         Then no dataspace is rewound.
+	 */
+	bool rollback(unsigned generations);
+
+	/**
+	 * Restore the checkpoint of `ds` into `target` on demand. Only
+	 * uncached dataspaces are supported, `target` has to be uncached and
+	 * physically contiguous like `ds`.
+	 *
+	 * The restore lives until `ds` is destroyed or restored again, because
+	 * the child keeps the managed dataspace attached.
+	 *
+	 * @return Managed dataspace which has to be attached to the region maps
+	 *         of the child instead of `target`. An invalid capability, if
+	 *         the dataspace has to be restored eagerly.
+	 */
+	Genode::Dataspace_capability restore_lazily(Ram_dataspace *ds,
+						    Genode::Ram_dataspace_capability target);
+
+	/**
+	 * Replica of the last checkpoint of `ds`, which is written by the same
+	 * CDMA submission as the checkpoint. Requires `<replica/>`.
+	 *
+	 * @return An invalid capability, if `ds` has no replica
+	 */
+	Genode::Ram_dataspace_capability replica(Ram_dataspace *ds);
+
+	/**
+	 * Populate `target` of a new child, which is forked from the last
+	 * checkpoint of `source` of `origin`, instead of running the start-up of
+	 * the child. Uncached dataspaces are collected and copied by
+	 * `fork_commit`, cached ones are copied by the CPU right away.
+	 */
+	void fork_dataspace(Ram_dataspace *target, Pd_cdma_session &origin,
+			    Ram_dataspace *source);
+
+	/**
+	 * Copy all collected dataspaces of a fork with a single descriptor
+	 * chain. Has to be called before the forked child starts.
+	 */
+	void fork_commit();
+
+	/**
+	 * Remember that `size` bytes at `offset` of the restored dataspace `ds`
+	 * are attached at `virt` in the address space of the child. With
+	 * `<prefault hot="true"/>` only the pages of the working set are
+	 * remembered. Requires `<prefault/>`.
+	 */
+	void prefault(Ram_dataspace *ds, Genode::addr_t virt,
+		      Genode::off_t offset, Genode::size_t size);
+
+	/**
+	 * Map all remembered ranges in the address space of the child with as
+	 * few calls as possible. Has to be called after all dataspaces are
+	 * attached and before the child resumes.
+	 *
+	 * @return Number of `map` calls
+	 */
+	unsigned prefault_commit();
+
+	/**
+	 * Predicted time in microseconds to copy all dataspaces of this session
+	 * by the modes, which are chosen for them
+	 */
+	Genode::uint64_t predict_checkpoint();
+
+	/**
+	 * Predicted time in microseconds to copy the dataspaces of all sessions
+	 */
+	static Genode::uint64_t predict_all();
 };
 
 #endif /* _RTCR_PD_CDMA_SESSION_H_ */
@@ -0,0 +1,115 @@
+/*
+ * \brief  Batched eager mapping of restored dataspaces
+ * \author Johannes Fischer
+ * \date   2019-10-04
+ */
+
+#ifndef _RTCR_CDMA_PREFAULT_H_
+#define _RTCR_CDMA_PREFAULT_H_
+
+/* Genode includes */
+#include <base/allocator.h>
+#include <pd_session/pd_session.h>
+#include <util/list.h>
+#include <util/misc_math.h>
+
+namespace Rtcr {
+	class Cdma_working_set;
+	class Cdma_prefault;
+}
+
+
+/**
+ * Pages of a dataspace which were written between the last two checkpoints.
+ * They are likely touched again right after a restore.
+ */
+class Rtcr::Cdma_working_set
+{
+public:
+	enum { PAGE_SIZE = 4096 };
+
+private:
+	Genode::Allocator &_alloc;
+	Genode::size_t const _pages;
+	Genode::uint8_t *_hot;
+
+public:
+	Cdma_working_set(Genode::Allocator &alloc, Genode::size_t size);
+	~Cdma_working_set();
+
+	/**
+	 * Mark the pages of `image` which differ from `next` as hot. Has to be
+	 * called before `image` is overwritten by `next`.
+	 */
+	void update(void const *image, void const *next, Genode::size_t size);
+
+	bool hot(Genode::size_t page) const { return page < _pages && _hot[page]; }
+
+	/**
+	 * Call `fn(offset, size)` for every run of hot pages in the range of
+	 * `size` bytes at `offset` of the dataspace. The runs are clipped to
+	 * the range.
+	 */
+	template <typename FN>
+	void for_each_hot_run(Genode::off_t offset, Genode::size_t size, FN const &fn) const
+	{
+		Genode::size_t const first = offset / PAGE_SIZE;
+		Genode::size_t const last  = (offset + size + PAGE_SIZE - 1) / PAGE_SIZE;
+		Genode::size_t run = first;
+		for(Genode::size_t page = first; page <= last; page++) {
+			if(page < last && hot(page))
+				continue;
+
+			if(page > run) {
+				Genode::size_t const from = Genode::max(run*PAGE_SIZE, (Genode::size_t)offset);
+				Genode::size_t const to   = Genode::min(page*PAGE_SIZE, offset + size);
+				fn(from, to - from);
+			}
+			run = page + 1;
+		}
+	}
+};
+
+
+/**
+ * Collects the virtual ranges of restored dataspaces in the address space of
+ * a child. Adjacent and overlapping ranges are merged, such that the whole
+ * set is mapped with few `Pd_session::map` calls instead of one page fault
+ * per page.
+ */
+class Rtcr::Cdma_prefault
+{
+private:
+	struct Range : Genode::List<Range>::Element {
+		Genode::addr_t start;
+		Genode::addr_t end;
+
+		Range(Genode::addr_t _start, Genode::addr_t _end)
+			: start(_start), end(_end) {}
+	};
+
+	Genode::Allocator &_alloc;
+
+	/* sorted by start, never overlapping or adjacent */
+	Genode::List<Range> _ranges;
+
+public:
+	Cdma_prefault(Genode::Allocator &alloc) : _alloc(alloc) {}
+	~Cdma_prefault() { clear(); }
+
+	/**
+	 * Add `size` bytes at virtual address `virt`
+	 */
+	void add(Genode::addr_t virt, Genode::size_t size);
+
+	/**
+	 * Map all collected ranges in `pd` and remove them
+	 *
+	 * @return Number of issued `map` calls
+	 */
+	unsigned apply(Genode::Pd_session &pd);
+
+	void clear();
+};
+
+#endif /* _RTCR_CDMA_PREFAULT_H_ */
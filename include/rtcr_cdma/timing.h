@@ -0,0 +1,136 @@
+/*
+ * \brief  Timing model of the dataspace copies of checkpoints
+ * \author Johannes Fischer
+ * \date   2019-10-19
+ */
+
+#ifndef _RTCR_CDMA_TIMING_H_
+#define _RTCR_CDMA_TIMING_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/lock.h>
+#include <timer_session/connection.h>
+#include <util/reconstructible.h>
+#include <util/xml_node.h>
+#include <cdma/driver.h>
+
+namespace Rtcr {
+	class Cdma_timing;
+}
+
+
+/**
+ * Predicts the time of a dataspace copy by a linear model per mode, i.e. a
+ * setup time per transfer plus the size divided by the throughput. The
+ * throughputs start with the calibration of the driver and both parameters
+ * follow the measured copies by an exponentially weighted moving average.
+ *
+ * With `<deadline us="..." window_us="..."/>`, a checkpoint is only admitted,
+ * if its predicted copy time fits the deadline, and a CDMA copy is split into
+ * chunks, which fit the pause window. The shared CDMA session is released
+ * between the chunks.
+ */
+class Rtcr::Cdma_timing
+{
+public:
+	enum Mode { CPU, CDMA, HYBRID, REPLICA, SPARSE, MODES };
+
+private:
+	enum {
+		/* throughput in MiB/s of a mode, which is neither calibrated nor
+		 * measured yet */
+		DEFAULT_THROUGHPUT = 100,
+
+		/* setup time in ns of a CDMA transfer, until it is measured */
+		DEFAULT_SETUP_NS = 20000,
+
+		/* copies of at least this size update the throughput, smaller
+		 * ones the setup time */
+		LARGE_COPY = 256*1024,
+
+		/* weight of a new measurement is 1/2^EWMA_SHIFT */
+		EWMA_SHIFT = 3,
+
+		PAGE_SIZE = 4096,
+	};
+
+	struct Model {
+		Genode::uint64_t bytes_per_ms;
+		Genode::uint64_t setup_ns;
+	};
+
+	Genode::Env &_env;
+	Genode::Lock _lock;
+	Genode::Constructible<Timer::Connection> _timer;
+
+	Model _models[MODES];
+
+	Genode::uint64_t _deadline_us = 0;
+	Genode::uint64_t _window_us = 0;
+
+	Cdma_timing(Genode::Env &env);
+
+	static Genode::uint64_t _bytes_per_ms(Genode::size_t mib_s) {
+		return (Genode::uint64_t)mib_s*1024*1024/1000; }
+
+	static Genode::uint64_t _ewma(Genode::uint64_t value, Genode::uint64_t sample) {
+		return value - (value >> EWMA_SHIFT) + (sample >> EWMA_SHIFT); }
+
+	Genode::size_t _chunk(Model const &model, Mode mode, Genode::size_t size) const;
+
+public:
+	/**
+	 * Singleton model shared by all intercepting pd sessions
+	 */
+	static Cdma_timing &factory(Genode::Env &env);
+
+	/**
+	 * Apply `<deadline us="..." window_us="..."/>`, which enables the model
+	 */
+	void configure(Genode::Xml_node deadline);
+
+	/**
+	 * Start the throughputs of the modes with the calibrated limits of the
+	 * CDMA session
+	 */
+	void calibrate(Cdma::Limits const &limits);
+
+	bool enabled() const { return _timer.constructed(); }
+
+	/**
+	 * Deadline of a checkpoint in microseconds, `0` if unbounded
+	 */
+	Genode::uint64_t deadline_us() const { return _deadline_us; }
+
+	/**
+	 * Current time for `observe`, `0` if the model is disabled
+	 */
+	Genode::uint64_t now() { return enabled() ? _timer->elapsed_us() : 0; }
+
+	/**
+	 * Update the model of `mode` by a copy of `size` bytes, which started at
+	 * `start_us` and is finished now
+	 */
+	void observe(Mode mode, Genode::size_t size, Genode::uint64_t start_us) {
+		if(enabled()) observe_us(mode, size, now() - start_us); }
+
+	/**
+	 * Update the model of `mode` by a copy of `size` bytes, which took `us`
+	 * microseconds, e.g. the sum of its parts without the waits in between
+	 */
+	void observe_us(Mode mode, Genode::size_t size, Genode::uint64_t us);
+
+	/**
+	 * Predicted time of a copy of `size` bytes in microseconds
+	 */
+	Genode::uint64_t predict(Mode mode, Genode::size_t size);
+
+	/**
+	 * Bytes of a CDMA copy, which are transferred at once such that a
+	 * transfer fits the pause window. `size`, if the window is unbounded.
+	 */
+	Genode::size_t chunk(Mode mode, Genode::size_t size);
+};
+
+#endif /* _RTCR_CDMA_TIMING_H_ */
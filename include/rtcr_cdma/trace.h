@@ -0,0 +1,127 @@
+/*
+ * \brief  Trace of the dataspace copies of checkpoints
+ * \author Johannes Fischer
+ * \date   2019-10-17
+ */
+
+#ifndef _RTCR_CDMA_TRACE_H_
+#define _RTCR_CDMA_TRACE_H_
+
+/* Genode includes */
+#include <base/env.h>
+#include <base/allocator.h>
+#include <base/lock.h>
+#include <os/reporter.h>
+#include <timer_session/connection.h>
+#include <util/reconstructible.h>
+#include <util/xml_node.h>
+
+namespace Rtcr {
+	class Cdma_trace;
+}
+
+
+/**
+ * Records every dataspace copy of a checkpoint in a compact record and
+ * reports the trace as `cdma_trace` after each checkpoint. The trace can be
+ * replayed against any `Cdma::Session` backend by `test/cdma_replay`, in
+ * order to evaluate changes of the driver with the copy pattern of a real
+ * workload.
+ *
+ * The size of a sparse copy is the size of its copied runs, without the
+ * zero pages.
+ *
+ * The report has the following format, times are in microseconds:
+ *
+ * ! <cdma_trace dropped="0">
+ * !   <checkpoint id="1" us="5120">
+ * !     <copy size="4096" start="12" us="3" engine="cpu" cached="yes"
+ * !           contiguous="yes" fallback="no"/>
+ * !     ...
+ * !   </checkpoint>
+ * ! </cdma_trace>
+ */
+class Rtcr::Cdma_trace
+{
+public:
+	/* the path, by which a dataspace was copied */
+	enum Engine { CPU, CDMA, HYBRID, REPLICA, SPARSE };
+
+	enum Flags { CACHED = 1, CONTIGUOUS = 2, FALLBACK = 4 };
+
+private:
+	/* 16 bytes per copy */
+	struct Record {
+		Genode::uint32_t start_us;
+		Genode::uint32_t duration_us;
+		Genode::uint32_t size;
+		Genode::uint16_t checkpoint;
+		Genode::uint8_t  engine;
+		Genode::uint8_t  flags;
+	};
+
+	/* duration of a checkpoint */
+	struct Checkpoint {
+		Genode::uint16_t id;
+		Genode::uint32_t duration_us;
+	};
+
+	enum { MAX_CHECKPOINTS = 256 };
+
+	Genode::Env &_env;
+	Genode::Allocator &_alloc;
+	Genode::Lock _lock;
+
+	Genode::Constructible<Timer::Connection> _timer;
+	Genode::Constructible<Genode::Expanding_reporter> _reporter;
+
+	Record *_records = nullptr;
+	unsigned _max = 0;
+	unsigned _count = 0;
+	unsigned _dropped = 0;
+
+	Checkpoint _checkpoints[MAX_CHECKPOINTS];
+	unsigned _checkpoint_count = 0;
+	Genode::uint16_t _checkpoint = 0;
+	Genode::uint64_t _checkpoint_start = 0;
+
+	Cdma_trace(Genode::Env &env, Genode::Allocator &alloc)
+		: _env(env), _alloc(alloc) {}
+
+	void _report();
+
+public:
+	/**
+	 * Singleton trace shared by all intercepting pd sessions
+	 */
+	static Cdma_trace &factory(Genode::Env &env, Genode::Allocator &alloc);
+
+	/**
+	 * Apply `<trace records="..."/>`, which enables the trace
+	 */
+	void configure(Genode::Xml_node trace);
+
+	bool enabled() const { return _records != nullptr; }
+
+	/**
+	 * Current time for `record`, `0` if the trace is disabled
+	 */
+	Genode::uint64_t now() { return enabled() ? _timer->elapsed_us() : 0; }
+
+	void checkpoint_begin();
+
+	/**
+	 * Finish the current checkpoint and report the trace
+	 */
+	void checkpoint_end();
+
+	/**
+	 * Record a copy of `size` bytes, which started at `start_us` and is
+	 * finished now. Copies beyond the configured number of records are
+	 * dropped.
+	 */
+	void record(Genode::uint64_t start_us, Genode::size_t size, Engine engine,
+		    unsigned flags);
+};
+
+#endif /* _RTCR_CDMA_TRACE_H_ */
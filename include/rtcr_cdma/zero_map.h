@@ -0,0 +1,137 @@
+/*
+ * \brief  Zero pages of a checkpointed ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-10-18
+ */
+
+#ifndef _RTCR_CDMA_ZERO_MAP_H_
+#define _RTCR_CDMA_ZERO_MAP_H_
+
+/* Genode includes */
+#include <base/allocator.h>
+#include <util/misc_math.h>
+
+namespace Rtcr {
+	class Cdma_zero_map;
+}
+
+
+/**
+ * Large parts of a freshly allocated heap are never written and stay zero.
+ * Before a checkpoint, the dataspace is scanned for zero pages. Only the runs
+ * of non-zero pages are copied, and zero pages are only written to the
+ * checkpoint image, if the image does not already contain zeros there.
+ */
+class Rtcr::Cdma_zero_map
+{
+public:
+	enum { PAGE_SIZE = 4096 };
+
+private:
+	enum {
+		/* a scan, which finds less than 1/2^MIN_ZERO_SHIFT zero pages,
+		 * costs about as much as it saves */
+		MIN_ZERO_SHIFT = 2,
+
+		/* copies without a scan after such a scan */
+		SKIPPED_SCANS = 8,
+	};
+
+	Genode::Allocator &_alloc;
+	Genode::size_t const _size;
+	Genode::size_t const _pages;
+
+	/* pages which are zero in the content of the last scan */
+	Genode::uint8_t *_next;
+
+	/* pages which are zero in the checkpoint image */
+	Genode::uint8_t *_image;
+
+	/* remaining copies without a scan */
+	unsigned _skip = 0;
+
+	/**
+	 * Call `fn(offset, size)` for every run of pages, for which
+	 * `match(page)` is true
+	 */
+	template <typename MATCH, typename FN>
+	void _for_each_run(MATCH const &match, FN const &fn) const
+	{
+		Genode::size_t run = 0;
+		for(Genode::size_t page = 0; page <= _pages; page++) {
+			if(page < _pages && match(page))
+				continue;
+
+			if(page > run) {
+				Genode::size_t const offset = run*PAGE_SIZE;
+				fn(offset, Genode::min(page*PAGE_SIZE, _size) - offset);
+			}
+			run = page + 1;
+		}
+	}
+
+public:
+	/**
+	 * @param image_zero `True`, if the checkpoint image is all zero, e.g.
+	 *                   because it is freshly allocated
+	 */
+	Cdma_zero_map(Genode::Allocator &alloc, Genode::size_t size, bool image_zero);
+	~Cdma_zero_map();
+
+	/**
+	 * Scan the next content `src` of the dataspace for zero pages
+	 *
+	 * @return Number of zero pages
+	 */
+	Genode::size_t scan(void const *src);
+
+	/**
+	 * `False`, if the last scan found so few zero pages, that the next
+	 * copies are not worth a scan of the whole dataspace by the CPU
+	 */
+	bool scan_due() const { return !_skip; }
+
+	/**
+	 * The dataspace was copied completely instead of scanned, thus the
+	 * image does not hold the zero pages of a former scan anymore
+	 */
+	void copied_without_scan();
+
+	/**
+	 * Call `fn(offset, size)` for every run of non-zero pages of the last
+	 * scan, which have to be copied
+	 */
+	template <typename FN>
+	void for_each_copy(FN const &fn) const
+	{
+		_for_each_run([&] (Genode::size_t page) { return !_next[page]; }, fn);
+	}
+
+	/**
+	 * Call `fn(offset, size)` for every run of zero pages of the last scan,
+	 * which are not zero in the image yet
+	 */
+	template <typename FN>
+	void for_each_clear(FN const &fn) const
+	{
+		_for_each_run([&] (Genode::size_t page) {
+			return _next[page] && !_image[page]; }, fn);
+	}
+
+	/**
+	 * The image was written with the content of the last scan
+	 */
+	void commit();
+
+	/**
+	 * The image was changed without a scan, e.g. by a rollback
+	 */
+	void invalidate();
+
+	/**
+	 * `True`, if all pages of the range are zero in the image
+	 */
+	bool zero(Genode::size_t offset, Genode::size_t size) const;
+};
+
+#endif /* _RTCR_CDMA_ZERO_MAP_H_ */
@@ -0,0 +1,17 @@
+# \brief  CDMA driver as library, for components which drive the CDMA IP
+#         core themselves instead of using the `Cdma` service of `cdma_drv`
+# \author Johannes Fischer
+# \date   2019-10-14
+
+SRC_CC = driver.cc local_session.cc soft_engine.cc soft_session.cc job_queue.cc
+LIBS   = base
+
+vpath %.cc $(REP_DIR)/src/drivers/cdma
+
+# In order to enable verbosity:
+#CC_OPT += -DVERBOSE
+
+# in order to enable debug output
+#CC_OPT += -DDEBUG
+
+CC_OPT += -w
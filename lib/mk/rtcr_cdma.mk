@@ -1,4 +1,5 @@
-SRC_CC = pd_session.cc cdma_module.cc
+SRC_CC = pd_session.cc cdma_module.cc copy_queue.cc dst_arena.cc history.cc lazy_restore.cc cpu_copier.cc prefault.cc fork.cc backend.cc trace.cc zero_map.cc timing.cc
+LIBS  += cdma
 
 vpath % $(REP_DIR)/src/rtcr_cdma
 
@@ -7,6 +7,9 @@
 
 #include <cdma/cdma.h>
 #include <cdma/driver.h>
+#include <util/misc_math.h>
+#include <util/string.h>
+#include <cpu/memory_barrier.h>
 
 using namespace Cdma;
 
@@ -14,14 +17,27 @@ using namespace Cdma;
 Driver::Driver(Genode::Env &env,
                Genode::addr_t cdma_address,
                Genode::uint32_t irq_number,
-               bool sg_enabled)
+               bool sg_enabled,
+               unsigned timeout_ms,
+               unsigned retries,
+               Genode::size_t max_btt,
+               bool calibrate,
+               Hardware const &hardware)
     :
     _env(env),
     _mmio_cdma(env, cdma_address),
     _sg_enabled(sg_enabled),
+    _hardware(hardware),
     _timer(env),
+    _timeout_ms(timeout_ms),
+    _watchdog(env),
+    _retries(retries),
+    _engine(&select_engine(sg_enabled, hardware)),
+    _limits { DEFAULT_MAX_BTT, DEFAULT_MAX_BTT & ~0xfffUL, 0, 0, 0 },
     _td_ds_cap(env.pd().alloc(TD_DS_SIZE, Cache_attribute::UNCACHED)),
     _td_phys_addr(Genode::Dataspace_client(_td_ds_cap).phys_addr()),
+    _pattern_ds_cap(env.pd().alloc(PATTERN_DS_SIZE, Cache_attribute::UNCACHED)),
+    _pattern_phys_addr(Genode::Dataspace_client(_pattern_ds_cap).phys_addr()),
     _irq(env, irq_number)
 
 {
@@ -30,28 +46,30 @@ Driver::Driver(Genode::Env &env,
     #endif
 
     _td_ds_addr = env.rm().attach(_td_ds_cap);
+    _pattern_ds_addr = env.rm().attach(_pattern_ds_cap);
 
     // initialize irq and signal receiver
     _irq.sigh(sig_rec.manage(&sig_ctx));
     _irq.ack_irq();
+
+    // the watchdog signals to the same receiver as the irq
+    _watchdog.sigh(sig_rec.manage(&_timeout_ctx));
     
     // reset CDMA.
     reset();
 
-    // initialize and wait until CDMA is available (timeout after 500ms)
+    // wait until CDMA is available. The CDMA is idle within a few cycles
+    // after the reset, thus it is polled without sleeping until the probe
+    // times out.
     _is_supported = false;
-    for(int i = 0; i < 50; i++)
-    {
-        if( is_idle())
+    Genode::uint64_t const deadline = _timer.elapsed_us() + PROBE_TIMEOUT_US;
+    do {
+        if(is_idle())
         {
-            _is_supported=true;
+            _is_supported = true;
             break;
         }
-        else
-        {
-            _timer.msleep(10);
-        }
-    }
+    } while(_timer.elapsed_us() < deadline);
 
     if(! _is_supported)
     {
@@ -67,16 +85,146 @@ Driver::Driver(Genode::Env &env,
             Genode::warning("Scather Gather Mode is enabled, but not supported by hardware. ",
                             "Fallback to Simple Mode.");
         }
+        _engine = &select_engine(_sg_enabled, _hardware);
+
+        // a smaller limit than the width of the register is fine
+        bool const configured = max_btt >= (1UL << MIN_BTT_WIDTH) - 1 &&
+                                max_btt <= (1UL << MAX_BTT_WIDTH) - 1;
+        if(max_btt && !configured)
+            Genode::warning("Invalid max BTT ", Hex(max_btt), ", the BTT register has ",
+                            MIN_BTT_WIDTH, " to ", MAX_BTT_WIDTH, " bits.");
+
+        // the width of the BTT register can not be read from the hardware,
+        // a wider value would be truncated silently by a narrower register
+        if(configured)
+            _limits.max_btt = max_btt;
+        else
+            Genode::warning("BTT width not configured, assume max BTT ",
+                            Hex(_limits.max_btt), " of the default design. ",
+                            "Configure `btt_width`.");
+
+        // every chunk starts page aligned, otherwise the following chunks
+        // are not aligned to the data width of the CDMA
+        _limits.chunk_size = max(_limits.max_btt & ~0xfffUL, (Genode::size_t) 0x1000);
+
+        if(calibrate)
+            this->calibrate();
+
+        Genode::log("CDMA ", _sg_enabled ? "scather gather" : "simple", " mode, ",
+                    _hardware.addr_64 ? 64 : 32, "-bit addresses, ",
+                    _hardware.dre ? "with" : "without", " realignment engine");
+        Genode::log("CDMA max BTT ", Hex(_limits.max_btt),
+                    ", chunk size ", Hex(_limits.chunk_size),
+                    ", crossover ", Hex(_limits.crossover));
     }
 }
 
 Driver::~Driver()
 {
+    _env.rm().detach(_pattern_ds_addr);
+    _env.pd().free(_pattern_ds_cap);
     _env.rm().detach(_td_ds_addr);
     _env.pd().free(_td_ds_cap);
 }
 
 
+unsigned Driver::btt_width(Genode::size_t max_btt)
+{
+    for(unsigned width = MIN_BTT_WIDTH; width <= MAX_BTT_WIDTH; width++)
+        if(max_btt == (1UL << width) - 1)
+            return width;
+    return 0;
+}
+
+
+Genode::uint64_t Driver::time_dma(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size)
+{
+    Genode::uint64_t const start = _timer.elapsed_us();
+    Destinations const destinations { { dst }, 1 };
+    for(unsigned i = 0; i < CALIBRATION_REPEAT; i++)
+        transfer(destinations, src, size, nullptr, false);
+    return max(_timer.elapsed_us() - start, (Genode::uint64_t) 1);
+}
+
+
+Genode::uint64_t Driver::time_cpu(void *dst, void const *src, Genode::size_t size)
+{
+    Genode::uint64_t const start = _timer.elapsed_us();
+    for(unsigned i = 0; i < CALIBRATION_REPEAT; i++)
+        Genode::memcpy(dst, src, size);
+    return max(_timer.elapsed_us() - start, (Genode::uint64_t) 1);
+}
+
+
+void Driver::calibrate()
+{
+    // the CPU copies between uncached mappings, as the CDMA is only used
+    // for uncached dataspaces
+    Genode::Ram_dataspace_capability src_cap =
+        _env.pd().alloc(CALIBRATION_SIZE, Cache_attribute::UNCACHED);
+    Genode::Ram_dataspace_capability dst_cap =
+        _env.pd().alloc(CALIBRATION_SIZE, Cache_attribute::UNCACHED);
+    void *src = _env.rm().attach(src_cap);
+    void *dst = _env.rm().attach(dst_cap);
+    Genode::addr_t const src_phys = Genode::Dataspace_client(src_cap).phys_addr();
+    Genode::addr_t const dst_phys = Genode::Dataspace_client(dst_cap).phys_addr();
+    Genode::memset(src, 0x5a, CALIBRATION_SIZE);
+
+    _transfer_throttle = Throttle();
+
+    try {
+        // descriptor size with the highest throughput for a large copy,
+        // larger descriptors win a tie
+        Genode::size_t best_chunk = _limits.chunk_size;
+        Genode::uint64_t best_us = ~0ULL;
+        for(Genode::size_t chunk = best_chunk; chunk >= 0x10000; chunk >>= 2)
+        {
+            _limits.chunk_size = chunk;
+            Genode::uint64_t const us = time_dma(dst_phys, src_phys, CALIBRATION_SIZE);
+            if(us < best_us) {
+                best_us = us;
+                best_chunk = chunk;
+            }
+        }
+        _limits.chunk_size = best_chunk;
+
+        // the crossover is the smallest size from which on the DMA always
+        // wins. If the CPU is faster for the largest size, DMA is never used.
+        _limits.crossover = ~(Genode::size_t)0;
+        for(Genode::size_t size = CALIBRATION_SIZE; size >= 0x1000; size >>= 2)
+        {
+            Genode::uint64_t const dma_us = time_dma(dst_phys, src_phys, size);
+            Genode::uint64_t const cpu_us = time_cpu(dst, src, size);
+
+            if(size == CALIBRATION_SIZE) {
+                Genode::uint64_t const bytes = (Genode::uint64_t)size * CALIBRATION_REPEAT;
+                _limits.dma_throughput = (bytes * 1000000 / dma_us) >> 20;
+                _limits.cpu_throughput = (bytes * 1000000 / cpu_us) >> 20;
+            }
+
+            #if defined(DEBUG) || defined(VERBOSE)
+            Genode::log("calibrate ", Hex(size), ": DMA ", dma_us, " us, CPU ", cpu_us, " us");
+            #endif
+
+            if(dma_us > cpu_us)
+                break;
+            _limits.crossover = size;
+        }
+
+        Genode::log("CDMA calibrated: DMA ", _limits.dma_throughput, " MiB/s, CPU ",
+                    _limits.cpu_throughput, " MiB/s");
+    } catch (Cdma::Exception &) {
+        Genode::warning("CDMA calibration failed, keep defaults.");
+        _limits.crossover = 0;
+    }
+
+    _env.rm().detach(dst);
+    _env.rm().detach(src);
+    _env.pd().free(dst_cap);
+    _env.pd().free(src_cap);
+}
+
+
 bool Driver::is_supported()
 {
     return _is_supported;
@@ -111,172 +259,754 @@ void Driver::print_registers()
                     _mmio_cdma.read<Mmio_cdma::TAILDESC_PNTR>() ));
 }
 
-void Driver::memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size)
+template <typename PROFILE>
+void Driver::transfer_segment(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                              Range &failed, bool keyhole_read)
 {
-    // only support memcpy, if initializing of this driver was successful.
-    if(! _is_supported)
-        throw Cdma::Function_unsupported();
-
-    _lock.lock();
     // if scather gather is enabled, use it.  Instead of using the loop
     // implemented in simple_memcpy, the CDMA IP is programmed with a loop.
-    if(_sg_enabled) {
-        sg_memcpy(dst, src, size);
+    if(PROFILE::sg) {
+        // smaller descriptors may not cover the transfer with the
+        // available descriptors, thus it is submitted in batches
+        // the product exceeds 32 bits with large descriptors
+        Genode::size_t const batch =
+            (Genode::size_t)min((Genode::uint64_t)(MAX_TD_COUNT / dst.count) * _limits.chunk_size,
+                                (Genode::uint64_t)size);
+        Genode::size_t const base = _progress_base;
+        for(Genode::size_t offset = 0; offset < size; offset += batch)
+        {
+            Genode::size_t const len = min(batch, size - offset);
+            _progress_base = base + offset;
+            try {
+                sg_memcpy<PROFILE>(offset_of(dst, offset), keyhole_read ? src : src + offset, len,
+                          failed, keyhole_read);
+            } catch (Cdma::Exception &) {
+                failed = Range { offset + failed.offset, size - offset - failed.offset };
+                throw;
+            }
+        }
     } else {
-        multiple_simple_memcpy(dst, src, size);
+        multiple_simple_memcpy<PROFILE>(dst, src, size, failed, keyhole_read);
     }
-    _lock.unlock();
 }
 
 
-void Driver::print_descriptor_list(Genode::uint32_t count)
+Destinations Driver::offset_of(Destinations const &dst, Genode::size_t offset)
 {
+    Destinations result = dst;
+    for(unsigned i = 0; i < dst.count; i++)
+        result.addr[i] += offset;
+    return result;
+}
 
-    for(uint32_t i = 0; i < count; i++)
+
+Genode::size_t Driver::segment_size(Genode::size_t size)
+{
+    if(!_transfer_throttle.active())
+        return size;
+
+    if(!_transfer_throttle.bandwidth)
+        return DUTY_SEGMENT_SIZE;
+
+    // bytes per time slice, but at least one page
+    Genode::uint64_t budget = (Genode::uint64_t)_transfer_throttle.bandwidth *
+                              _transfer_throttle.slice_us / 1000000;
+    return max((Genode::size_t) budget, (Genode::size_t) 0x1000);
+}
+
+
+void Driver::throttle_pause(Genode::uint64_t start_us, Genode::size_t size)
+{
+    Genode::uint64_t const busy_us = _timer.elapsed_us() - start_us;
+    Genode::uint64_t pause_us = 0;
+
+    // the segment must not finish earlier than the bandwidth allows
+    if(_transfer_throttle.bandwidth)
     {
-        uint64_t td_addr =  (uint64_t)_td_ds_addr + i*0x40;
-        Genode::log("td[", i,"]::NXTDESC_PNTR:    ", Hex(*(uint32_t *)(td_addr+0x00))); 
-        Genode::log("td[", i,"]::NXTDESC_PNTR_MSB ", Hex(*(uint32_t *)(td_addr+0x04)));       
-        Genode::log("td[", i,"]::SA:              ", Hex(*(uint32_t *)(td_addr+0x08)));
-        Genode::log("td[", i,"]::SA_MSB           ", Hex(*(uint32_t *)(td_addr+0x0c)));        
-        Genode::log("td[", i,"]::DA:              ", Hex(*(uint32_t *)(td_addr+0x10)));
-        Genode::log("td[", i,"]::DA_MSB:          ", Hex(*(uint32_t *)(td_addr+0x1c)));        
-        Genode::log("td[", i,"]::CONTROL:         ", Hex(*(uint32_t *)(td_addr+0x18)));
-        Genode::log("td[", i,"]::STATUS:          ", Hex(*(uint32_t *)(td_addr+0x1c)));
+        Genode::uint64_t min_us = (Genode::uint64_t)size * 1000000 /
+                                  _transfer_throttle.bandwidth;
+        if(busy_us < min_us)
+            pause_us = min_us - busy_us;
     }
+
+    // the CDMA is idle for the rest of the duty cycle
+    unsigned const duty = max(_transfer_throttle.duty, 1U);
+    if(duty < 100)
+        pause_us = max(pause_us, busy_us * (100 - duty) / duty);
+
+    if(pause_us)
+        _timer.usleep(pause_us);
 }
 
 
+template <typename PROFILE>
+void Driver::run_transfer(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                          Range *failed, bool keyhole_read)
+{
+    for(unsigned i = 0; i < dst.count; i++)
+    {
+        if(!aligned<PROFILE>(dst.addr[i], src)) {
+            if(failed)
+                *failed = Range { 0, size };
+            throw Cdma::Invalid_memcpy_address();
+        }
+    }
+
+    Genode::size_t const segment = segment_size(size);
+
+    for(Genode::size_t offset = 0; offset < size; offset += segment)
+    {
+        Genode::size_t const len = min(segment, size - offset);
+        Genode::uint64_t const start_us = _transfer_throttle.active() ? _timer.elapsed_us() : 0;
+
+        Range failed_range { 0, 0 };
+        try {
+            _progress_base = offset;
+            transfer_segment<PROFILE>(offset_of(dst, offset), keyhole_read ? src : src + offset, len,
+                                      failed_range, keyhole_read);
+        } catch (Cdma::Exception &) {
+            // all segments behind the failed one are not copied either
+            _progress_base = 0;
+            if(failed)
+                *failed = Range { offset + failed_range.offset,
+                                  size - offset - failed_range.offset };
+            throw;
+        }
+
+        if(_transfer_throttle.active() && offset + len < size)
+            throttle_pause(start_us, len);
+    }
+    _progress_base = 0;
+}
 
-void Driver::sg_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t size)
+
+void Driver::progress(Progress *progress, unsigned interval)
 {
-	#if defined(DEBUG) || defined(VERBOSE)
-    Genode::log("sg_memcpy(", Hex(dst), ", ", Hex(src), ", ", Hex(size), ")");    
-    #endif
+    _progress = progress;
+    _progress_interval = interval;
 
-    // bytes to copy
-    Genode::size_t btt;
+    // the cursor of a chain moves with its interrupts
+    if(_progress && _sg_enabled && interval > MAX_IRQ_THRESHOLD)
+    {
+        _progress_interval = MAX_IRQ_THRESHOLD;
+        if(!_interval_clamped)
+            Genode::warning("progress interval of ", interval, " descriptors exceeds "
+                            "the interrupt threshold, the cursor moves every ",
+                            (unsigned)MAX_IRQ_THRESHOLD, " descriptors");
+        _interval_clamped = true;
+    }
 
-    // offset from where copy starts
-    Genode::uint64_t offset = 0;
+    if(_progress)
+    {
+        _progress->completed = 0;
+        Genode::memory_barrier();
+        _progress->transfer = _progress->transfer + 1;
+    }
+}
 
-    // points to first processed td in physical memory
-    Genode::uint64_t td_head_phys_addr = _td_phys_addr;
 
-    // points to the previous td
-    Genode::uint64_t td_previous_phys_addr = td_head_phys_addr;
+void Driver::report_progress(Genode::size_t completed)
+{
+    if(!_progress)
+        return;
 
-    // points to the start of the first td in attached dataspace.
-    Genode::uint64_t td_head_ds_addr = (uint64_t)_td_ds_addr;
+    // the copied data has to be visible, before the cursor moves
+    Genode::memory_barrier();
+    _progress->completed = _progress_base + completed;
+}
 
-    Genode::uint32_t td_counter = 0;
-    do
+
+void Driver::memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size,
+                    Range *failed, Progress *progress, unsigned progress_interval,
+                    Throttle const &throttle)
+{
+    // only support memcpy, if initializing of this driver was successful.
+    if(! _is_supported)
+        throw Cdma::Function_unsupported();
+
+    if(!size)
+        return;
+
+    // the guard releases the lock, even if the transfer throws an exception
+    Genode::Lock::Guard guard(_lock);
+    _transfer_throttle = throttle.active() ? throttle : _throttle;
+    this->progress(progress, progress_interval);
+    transfer(Destinations { { dst }, 1 }, src, size, failed, false);
+    report_progress(size);
+    this->progress(nullptr, 0);
+}
+
+
+void Driver::fanout(Destinations const &dst, Genode::addr_t src, Genode::size_t size,
+                    Range *failed, Throttle const &throttle)
+{
+    if(! _is_supported)
+        throw Cdma::Function_unsupported();
+
+    if(!dst.count || dst.count > Destinations::MAX)
+        throw Cdma::Invalid_memcpy_address();
+
+    if(!size)
+        return;
+
+    Genode::Lock::Guard guard(_lock);
+    _transfer_throttle = throttle.active() ? throttle : _throttle;
+
+    // the descriptors are not a prefix of a single destination, thus there
+    // is no completion cursor
+    progress(nullptr, 0);
+    transfer(dst, src, size, failed, false);
+}
+
+
+template <typename PROFILE, typename FN>
+void Driver::sg_copies(unsigned count, FN const &copy_at, Range &failed)
+{
+    Genode::size_t const chunk_size = _limits.chunk_size;
+
+    // first copy of the current chain
+    unsigned first = 0;
+    while(first < count)
     {
-        if(size >= MAX_BTT)
+        Genode::uint64_t const start_us = _transfer_throttle.active() ? _timer.elapsed_us() : 0;
+
+        // fill the chain with all copies whose descriptors fit into it
+        Genode::uint32_t td_count = 0;
+        Genode::size_t pending = 0;
+        unsigned next = first;
+        for(; next < count; next++)
         {
-            btt = MAX_BTT;
-            size -= MAX_BTT;
-        } else {
-            btt = size;
-            size = 0;
+            Copy const copy = copy_at(next);
+            if(!aligned<PROFILE>(copy.dst, copy.src)) {
+                failed = Range { first, count - first };
+                throw Cdma::Invalid_memcpy_address();
+            }
+
+            Genode::size_t const chunks = (copy.size + chunk_size - 1) / chunk_size;
+            if(td_count + chunks > MAX_TD_COUNT)
+                break;
+
+            for(Genode::size_t offset = 0; offset < copy.size; offset += chunk_size)
+                write_descriptor<PROFILE>(td_count++,
+                                          (Genode::uint64_t)copy.src + offset,
+                                          (Genode::uint64_t)copy.dst + offset,
+                                          min(copy.size - offset, chunk_size));
+            pending += copy.size;
         }
-        
-        // create descriptor in td dataspace and insert it at the start of the td list.
-        *((int *)(td_head_ds_addr+0x00)) = (uint32_t) td_previous_phys_addr;
-        *((int *)(td_head_ds_addr+0x04)) = (uint32_t) (td_previous_phys_addr << 32);
-        *((int *)(td_head_ds_addr+0x08)) = (uint32_t) (src + offset); // src
-        *((int *)(td_head_ds_addr+0x0c)) = (uint32_t) ((src + offset) << 32);
-        *((int *)(td_head_ds_addr+0x10)) = (uint32_t) (dst + offset); // dst
-        *((int *)(td_head_ds_addr+0x14)) = (uint32_t) ((dst + offset) << 32);
-        *((int *)(td_head_ds_addr+0x18)) = (uint32_t) btt; // bytes to transfer.
-        *((int *)(td_head_ds_addr+0x1c)) = 0x00000000; // status filled by device
-
-        td_head_ds_addr += TD_SIZE; // prepare next descriptor position for head
-        td_previous_phys_addr = td_head_phys_addr;
-        td_head_phys_addr += TD_SIZE; // prepare next descriptor position for head
-        offset += btt;
-        td_counter++;
-    } while(size > 0);
 
-    
-    // enable interrupts for notifying complete transfer
-    _mmio_cdma.write<Mmio_cdma::CDMACR::IOC_IrqEn>(1);
-    _mmio_cdma.write<Mmio_cdma::CDMACR::Err_IrqEn>(1);
-    _mmio_cdma.write<Mmio_cdma::CDMACR::IRQThreshold>(td_counter);
-    
-    // initialize Scather Gather Mode by setting it to zero and than to one.
-    _mmio_cdma.write<Mmio_cdma::CDMACR::SGMode>(0);
-    _mmio_cdma.write<Mmio_cdma::CDMACR::SGMode>(1);
+        // a copy which exceeds the descriptors on its own is split by
+        // `transfer`
+        if(next == first)
+        {
+            Copy const copy = copy_at(first);
+            try {
+                run_transfer<PROFILE>(Destinations { { copy.dst }, 1 }, copy.src, copy.size,
+                                      nullptr, false);
+            } catch (Cdma::Exception &) {
+                failed = Range { first, count - first };
+                throw;
+            }
+            first++;
+            continue;
+        }
 
-    
+        if(!td_count) {
+            first = next;
+            continue;
+        }
+
+        Completion completion = sg_run<PROFILE>(td_count, pending, false);
+        if(completion != COMPLETE)
+        {
+            // the copy of a descriptor is the one whose destination contains it
+            unsigned failed_copy = next;
+            for(uint32_t i = 0; i < td_count; i++)
+            {
+                if(Descriptor::Status::Cmplt::get(td(i)->status))
+                    continue;
+
+                Genode::uint64_t da = ((Genode::uint64_t)td(i)->da_msb << 32) | td(i)->da;
+                for(unsigned j = first; j < failed_copy; j++)
+                {
+                    Copy const copy = copy_at(j);
+                    if(da >= copy.dst && da < copy.dst + copy.size) {
+                        failed_copy = j;
+                        break;
+                    }
+                }
+            }
+            if(failed_copy == next)
+                failed_copy = first;
+            failed = Range { failed_copy, count - failed_copy };
+            reset();
+            throw_error(completion);
+        }
+
+        if(_transfer_throttle.active() && next < count)
+            throttle_pause(start_us, pending);
+        first = next;
+    }
+}
+
+
+template <typename PROFILE, typename FN>
+void Driver::run_copies(unsigned count, FN const &copy_at, Range *failed)
+{
+    Range failed_range { 0, 0 };
+    if(PROFILE::sg) {
+        try {
+            sg_copies<PROFILE>(count, copy_at, failed_range);
+        } catch (Cdma::Exception &) {
+            if(failed)
+                *failed = failed_range;
+            throw;
+        }
+        return;
+    }
+
+    for(unsigned i = 0; i < count; i++)
+    {
+        Copy const copy = copy_at(i);
+        try {
+            run_transfer<PROFILE>(Destinations { { copy.dst }, 1 }, copy.src, copy.size,
+                                  nullptr, false);
+        } catch (Cdma::Exception &) {
+            if(failed)
+                *failed = Range { i, count - i };
+            throw;
+        }
+    }
+}
+
+
+void Driver::batch(Copy const *copies, unsigned count, Range *failed,
+                   Throttle const &throttle)
+{
+    if(! _is_supported)
+        throw Cdma::Function_unsupported();
+
+    if(count > Batch::MAX)
+        throw Cdma::Invalid_memcpy_address();
+
+    Genode::Lock::Guard guard(_lock);
+    _transfer_throttle = throttle.active() ? throttle : _throttle;
+    progress(nullptr, 0);
+    (this->*_engine->batch)(copies, count, failed);
+}
+
+
+template <typename PROFILE>
+void Driver::run_batch(Copy const *copies, unsigned count, Range *failed)
+{
+    run_copies<PROFILE>(count, [&] (unsigned i) { return copies[i]; }, failed);
+}
+
+
+void Driver::stride(Genode::addr_t dst, Genode::size_t dst_pitch,
+                    Genode::addr_t src, Genode::size_t src_pitch,
+                    Genode::size_t row_size, unsigned rows,
+                    Range *failed, Throttle const &throttle)
+{
+    if(! _is_supported)
+        throw Cdma::Function_unsupported();
+
+    if(!row_size || !rows)
+        return;
+
+    Genode::Lock::Guard guard(_lock);
+    _transfer_throttle = throttle.active() ? throttle : _throttle;
+    progress(nullptr, 0);
+    (this->*_engine->stride)(dst, dst_pitch, src, src_pitch, row_size, rows, failed);
+}
+
+
+template <typename PROFILE>
+void Driver::run_stride(Genode::addr_t dst, Genode::size_t dst_pitch,
+                        Genode::addr_t src, Genode::size_t src_pitch,
+                        Genode::size_t row_size, unsigned rows, Range *failed)
+{
+    run_copies<PROFILE>(rows, [&] (unsigned i) {
+        return Copy { dst + i*dst_pitch, src + i*src_pitch, row_size }; }, failed);
+}
+
+
+void Driver::memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size,
+                    Range *failed, Throttle const &throttle)
+{
+    if(! _is_supported)
+        throw Cdma::Function_unsupported();
+
+    if(!size)
+        return;
+
+    Genode::Lock::Guard guard(_lock);
+    _transfer_throttle = throttle.active() ? throttle : _throttle;
+
+    // keyhole read fetches a full data beat from the same address, thus the
+    // value is replicated over the pattern buffer.
+    Genode::memset(_pattern_ds_addr, value, PATTERN_DS_SIZE);
+    progress(nullptr, 0);
+    transfer(Destinations { { dst }, 1 }, _pattern_phys_addr, size, failed, true);
+}
+
+
+void Driver::print_descriptor_list(Genode::uint32_t count)
+{
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        Descriptor volatile *d = td(i);
+        Genode::log("td[", i,"]::NXTDESC_PNTR:    ", Hex(d->nxtdesc_pntr));
+        Genode::log("td[", i,"]::NXTDESC_PNTR_MSB ", Hex(d->nxtdesc_pntr_msb));
+        Genode::log("td[", i,"]::SA:              ", Hex(d->sa));
+        Genode::log("td[", i,"]::SA_MSB           ", Hex(d->sa_msb));
+        Genode::log("td[", i,"]::DA:              ", Hex(d->da));
+        Genode::log("td[", i,"]::DA_MSB:          ", Hex(d->da_msb));
+        Genode::log("td[", i,"]::CONTROL:         ", Hex(d->control));
+        Genode::log("td[", i,"]::STATUS:          ", Hex(d->status));
+    }
+}
+
+
+Descriptor volatile *Driver::td(Genode::uint32_t i)
+{
+    return (Descriptor volatile *)((Genode::addr_t)_td_ds_addr + i*TD_SIZE);
+}
+
+
+Genode::uint64_t Driver::td_phys_addr(Genode::uint32_t i)
+{
+    return _td_phys_addr + i*TD_SIZE;
+}
+
+
+template <typename PROFILE>
+void Driver::write_descriptor(Genode::uint32_t i, Genode::uint64_t sa, Genode::uint64_t da,
+                              Genode::size_t btt)
+{
+    Descriptor volatile *d = td(i);
+    d->sa = (uint32_t) sa;
+    d->da = (uint32_t) da;
+    if(PROFILE::addr_64) {
+        d->sa_msb = (uint32_t) (sa >> 32);
+        d->da_msb = (uint32_t) (da >> 32);
+    }
+    d->control = (uint32_t) btt;
+}
+
+
+template <typename PROFILE>
+void Driver::link_descriptors(Genode::uint32_t count)
+{
+    // descriptors are processed in ascending order. The last descriptor
+    // points to itself, because it is the tail of the chain.
+    for(uint32_t i = 0; i < count; i++)
+    {
+        Genode::uint64_t next = td_phys_addr(i + 1 < count ? i + 1 : i);
+        td(i)->nxtdesc_pntr = (uint32_t) next;
+        if(PROFILE::addr_64)
+            td(i)->nxtdesc_pntr_msb = (uint32_t) (next >> 32);
+        td(i)->status = 0; // status filled by device
+    }
+}
+
+
+template <typename PROFILE>
+void Driver::start_chain(Genode::uint32_t count)
+{
     // start td processing with head of td list
-    _mmio_cdma.write<Mmio_cdma::CURDESC_PNTR>((uint32_t) td_previous_phys_addr);
-    _mmio_cdma.write<Mmio_cdma::CURDESC_PNTR_MSB>((uint32_t) (td_previous_phys_addr << 32));
+    if(PROFILE::addr_64)
+        _mmio_cdma.write<Mmio_cdma::CURDESC_PNTR_MSB>((uint32_t) (td_phys_addr(0) >> 32));
+    _mmio_cdma.write<Mmio_cdma::CURDESC_PNTR>((uint32_t) td_phys_addr(0));
 
 	#if defined(DEBUG)
     Genode::log("Registers before memcpy:");
     print_registers();
     #endif
+
+    // processing is finished, when reaching the tail of td list. Writing the
+    // lower half of this register will start the copying, thus the upper
+    // half is written first.
+    if(PROFILE::addr_64)
+        _mmio_cdma.write<Mmio_cdma::TAILDESC_PNTR_MSB>((uint32_t) (td_phys_addr(count - 1) >> 32));
+    _mmio_cdma.write<Mmio_cdma::TAILDESC_PNTR>((uint32_t) td_phys_addr(count - 1));
+}
+
+
+template <typename PROFILE>
+bool Driver::aligned(Genode::uint64_t dst, Genode::uint64_t src)
+{
+    if(PROFILE::dre)
+        return true;
+
+    // the data width is a power of two of at most 128 bytes
+    Genode::uint64_t const mask = PROFILE::data_width - 1;
+    return !(dst & mask) && !(src & mask);
+}
+
+
+template <typename PROFILE>
+Driver::Completion Driver::sg_transfer(Genode::uint32_t count, Genode::size_t size,
+                                       bool keyhole_read)
+{
+    link_descriptors<PROFILE>(count);
+
+    // enable interrupts for notifying complete transfer. All control bits
+    // are composed in the shadow register and written at once. The
+    // threshold is limited to 8 bit. A chain with more descriptors raises
+    // an IOC interrupt every 255 descriptors, which `wait_for_completion`
+    // tells apart from the last one by the status of the last descriptor.
+    _mmio_cdma.control<Mmio_cdma::CDMACR::IOC_IrqEn>(1);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::Err_IrqEn>(1);
+    // Without a completion cursor, the interrupt is only raised after the
+    // last descriptor.
+    unsigned const threshold = min(_progress && _progress_interval ? _progress_interval
+                                                                    : count,
+                                   (unsigned)MAX_IRQ_THRESHOLD);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::IRQThreshold>(threshold);
+    // the threshold counter only raises IOC when it reaches zero. Only if
+    // the last descriptor does not complete a threshold, the delay interrupt
+    // is needed after it. Otherwise, it would fire between descriptors,
+    // which take longer than the delay, e.g. multi-MiB ones.
+    bool const delay = !threshold || count % threshold || count > MAX_IRQ_THRESHOLD;
+    _mmio_cdma.control<Mmio_cdma::CDMACR::Dly_IrqEn>(delay);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::IRQDelay>(IRQ_DELAY);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::Key_Hole_Read>(keyhole_read);
     
-    // processing is finished, when reaching the tail of td list. The first
-    // element of the descriptor list is always written at the beginning of the
-    // dataspace. Therefore it is the last processed element in the chain. The
-    // physical start of the dataspace is the TAILDESC pointer.
-    // Writing this register will start the copying.
-    _mmio_cdma.write<Mmio_cdma::TAILDESC_PNTR>((uint32_t) _td_phys_addr);
-    _mmio_cdma.write<Mmio_cdma::TAILDESC_PNTR_MSB>((uint32_t) (_td_phys_addr << 32));    
+    // initialize Scather Gather Mode by setting it to zero and than to one.
+    _mmio_cdma.control<Mmio_cdma::CDMACR::SGMode>(0);
+    _mmio_cdma.commit_control();
+    _mmio_cdma.control<Mmio_cdma::CDMACR::SGMode>(1);
+    _mmio_cdma.commit_control();
+
+    start_chain<PROFILE>(count);
 
-    // waiting for interrupt
-    sig_rec.wait_for_signal();
+    Completion completion = wait_for_completion(size, count);
 
 	#if defined(DEBUG)
     Genode::log("Registers after memcpy:");
     print_registers();
-    print_descriptor_list(td_counter);    
+    print_descriptor_list(count);
     #endif
-    
-    // got interrupt, because the CDMA IP core successfully copied    
-    if(_mmio_cdma.read<Mmio_cdma::CDMASR::IOC_Irq>())
-    {
-        _mmio_cdma.write<Mmio_cdma::CDMASR::IOC_Irq>(1); // clear interrupt
-        _irq.ack_irq();
-    }
-    // otherwise it is an error interrupt
-    else if(_mmio_cdma.read<Mmio_cdma::CDMASR::Err_Irq>())
+
+    return completion;
+}
+
+
+Driver::Completion Driver::wait_for_completion(Genode::size_t size,
+                                               Genode::uint32_t count)
+{
+    // arm the watchdog. A timeout of a previous transfer might still be
+    // delivered, therefore the deadline is checked as well.
+    unsigned long const timeout_ms = _timeout_ms + (size >> 20) * TIMEOUT_MS_PER_MIB;
+    unsigned long const deadline = _watchdog.elapsed_ms() + timeout_ms;
+    _watchdog.trigger_once(timeout_ms * 1000);
+
+    while(true)
     {
-        _mmio_cdma.write<Mmio_cdma::CDMASR::Err_Irq>(1); // clear interrupt
-        _irq.ack_irq();
+        Genode::Signal signal = sig_rec.wait_for_signal();
 
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::SGIntErr>())
+        if(signal.context() == &_timeout_ctx)
+        {
+            if(_watchdog.elapsed_ms() < deadline)
+                continue;
+
+            // a transfer, whose last interrupt got lost, is complete anyway
+            if(count && Descriptor::Status::Cmplt::get(td(count - 1)->status))
+            {
+                Genode::warning("CDMA transfer completed without interrupt.");
+                return COMPLETE;
+            }
+
+            Genode::error("CDMA transfer timed out after ", timeout_ms, " ms.");
+            return TIMEOUT;
+        }
+
+        // read status once and decode the snapshot
+        Mmio_cdma::CDMASR::access_t const status = _mmio_cdma.status();
+
+        // got interrupt, because the CDMA IP core successfully copied the
+        // threshold of descriptors or became idle for the delay
+        if(Mmio_cdma::CDMASR::IOC_Irq::get(status) ||
+           Mmio_cdma::CDMASR::Dly_Irq::get(status))
+        {
+            _mmio_cdma.clear_status(Mmio_cdma::CDMASR::IOC_Irq::masked(status) |
+                                    Mmio_cdma::CDMASR::Dly_Irq::masked(status));
+            _irq.ack_irq();
+
+            // in scather gather mode, the interrupt might only signal the
+            // completion of the first `IRQThreshold` descriptors.
+            if(!count || Descriptor::Status::Cmplt::get(td(count - 1)->status))
+                return COMPLETE;
+
+            // move the cursor behind the leading completed descriptors
+            Genode::size_t completed = 0;
+            for(uint32_t i = 0; i < count && Descriptor::Status::Cmplt::get(td(i)->status); i++)
+                completed += td(i)->control;
+            report_progress(completed);
+        }
+        // otherwise it is an error interrupt
+        else if(Mmio_cdma::CDMASR::Err_Irq::get(status))
         {
-            Genode::error("A internal error has been encountered by the DataMover ",
-                          "on the data transport channel.");
-            throw Cdma::Internal_memcpy_error();
+            _mmio_cdma.clear_status(Mmio_cdma::CDMASR::Err_Irq::bits(1));
+            _irq.ack_irq();
+            _error_status = status;
+            return FAILED;
         }
+        else
+        {
+            // a late interrupt of an aborted transfer
+            #if defined(DEBUG)
+            Genode::log("Got interrupt from unknown source.");
+            #endif
+            _irq.ack_irq();
+        }
+    }
+}
+
+
+void Driver::throw_error(Completion completion)
+{
+    if(completion == TIMEOUT)
+        throw Cdma::Memcpy_timeout();
+
+    Mmio_cdma::CDMASR::access_t const status = _error_status;
+
+    // is it an internal error?
+    if(Mmio_cdma::CDMASR::DMAIntErr::get(status) ||
+       Mmio_cdma::CDMASR::SGIntErr::get(status))
+    {
+        Genode::error("A internal error has been encountered by the DataMover ",
+                      "on the data transport channel.");
+        throw Cdma::Internal_memcpy_error();
+    }
+
+    // is it a slave error?
+    if(Mmio_cdma::CDMASR::DMASlvErr::get(status) ||
+       Mmio_cdma::CDMASR::SGSlvErr::get(status))
+    {
+        Genode::error("AXI slave error response has been received by the ",
+                      "AXI DataMover during an AXI transfer.");
+        throw Cdma::Internal_memcpy_error();
+    }
+
+    // is it a decode error?
+    if(Mmio_cdma::CDMASR::DMADecErr::get(status) ||
+       Mmio_cdma::CDMASR::SGDecErr::get(status))
+    {
+        Genode::error("An AXI decode error has been received by the AXI DataMover. ",
+                      "This error occurs if the DataMover issues an address request ",
+                      "to an invalid location.");
+        throw Cdma::Invalid_memcpy_address();
+    }
+
+    // this should never ever happen.
+    Genode::error("Got error interrupt without error status.");
+    throw Cdma::Internal_memcpy_error();
+}
 
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::SGSlvErr>())
+
+template <typename PROFILE>
+Driver::Completion Driver::sg_run(Genode::uint32_t &count, Genode::size_t pending,
+                                  bool keyhole_read)
+{
+    Completion completion = sg_transfer<PROFILE>(count, pending, keyhole_read);
+
+    // resubmitted descriptors are no longer a prefix of the transfer, thus
+    // the cursor stays until the transfer is complete.
+    Progress *progress = _progress;
+    if(completion != COMPLETE)
+        _progress = nullptr;
+
+    for(unsigned retry = 0; completion != COMPLETE && retry < _retries; retry++)
+    {
+        // move all descriptors which did not complete to the front and only
+        // resubmit those.
+        Genode::uint32_t failed_count = 0;
+        pending = 0;
+        for(uint32_t i = 0; i < count; i++)
         {
-            Genode::error("AXI slave error response has been received by the ",
-                          "AXI DataMover during an AXI transfer.");
-            throw Cdma::Internal_memcpy_error();
+            if(Descriptor::Status::Cmplt::get(td(i)->status))
+                continue;
+
+            Descriptor volatile *d = td(i);
+            write_descriptor<PROFILE>(failed_count++,
+                                      ((Genode::uint64_t)d->sa_msb << 32) | d->sa,
+                                      ((Genode::uint64_t)d->da_msb << 32) | d->da,
+                                      d->control);
+            pending += d->control;
         }
 
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::SGDecErr>())
+        Genode::warning("CDMA transfer failed, resubmit ", failed_count,
+                        " of ", count, " descriptors.");
+        reset();
+
+        count = failed_count;
+        completion = sg_transfer<PROFILE>(count, pending, keyhole_read);
+    }
+
+    _progress = progress;
+    return completion;
+}
+
+
+template <typename PROFILE>
+void Driver::sg_memcpy(Destinations const &dst, Genode::uint64_t src, Genode::size_t size,
+                       Range &failed, bool keyhole_read)
+{
+	#if defined(DEBUG) || defined(VERBOSE)
+    Genode::log("sg_memcpy(", Hex(dst.addr[0]), " (", dst.count, "), ", Hex(src), ", ", Hex(size), ")");    
+    #endif
+
+    // create one descriptor per chunk and destination. The descriptors of
+    // a chunk are adjacent, thus the source chunk is read again while it is
+    // still open in the DRAM row buffer.
+    Genode::size_t const chunk_size = _limits.chunk_size;
+    Genode::uint32_t count = 0;
+    for(Genode::size_t offset = 0; offset < size; offset += chunk_size)
+    {
+        Genode::size_t btt = min(size - offset, chunk_size);
+        Genode::uint64_t sa = keyhole_read ? src : src + offset;
+        for(unsigned i = 0; i < dst.count; i++, count++)
+            write_descriptor<PROFILE>(count, sa, (Genode::uint64_t)dst.addr[i] + offset, btt);
+    }
+
+    Completion completion = sg_run<PROFILE>(count, size * dst.count, keyhole_read);
+    if(completion == COMPLETE)
+        return;
+
+    // report the range which spans all descriptors which are not completed
+    Genode::size_t first = size, last = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(Descriptor::Status::Cmplt::get(td(i)->status))
+            continue;
+
+        // the destination of the descriptor is the one which contains it
+        Genode::uint64_t da = td(i)->da;
+        if(PROFILE::addr_64)
+            da |= (Genode::uint64_t)td(i)->da_msb << 32;
+        for(unsigned j = 0; j < dst.count; j++)
         {
-            Genode::error("An AXI decode error has been received by the AXI DataMover. ",
-                          "This error occurs if the DataMover issues an address request ",
-                          "to an invalid location.");
-            throw Cdma::Invalid_memcpy_address();
+            if(da < dst.addr[j] || da >= dst.addr[j] + size)
+                continue;
+
+            first = min(first, (Genode::size_t)(da - dst.addr[j]));
+            last = max(last, (Genode::size_t)(da - dst.addr[j]) + td(i)->control);
+            break;
         }
-    } else {
-        // this should never ever happen.
-        Genode::error("Got interrupt from unknown source.");
-        throw Cdma::Internal_memcpy_error();            
     }
+    failed.offset = first < last ? first : 0;
+    failed.size = first < last ? last - first : size;
+
+    reset();
+    throw_error(completion);
 }
 
 
-void Driver::simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t btt)
+template <typename PROFILE>
+Driver::Completion Driver::simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src,
+                                         Genode::size_t btt, bool keyhole_read)
 {
 	#if defined(DEBUG) || defined(VERBOSE)
     Genode::log("simple_memcpy(", Hex(dst), ", ", Hex(src), ", ", Hex(btt), ")");
@@ -286,113 +1016,201 @@ void Driver::simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::s
     reset();
 
     // enable interrupts for notifying complete transfer    
-    _mmio_cdma.write<Mmio_cdma::CDMACR::IOC_IrqEn>(1);
-    _mmio_cdma.write<Mmio_cdma::CDMACR::Err_IrqEn>(1);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::IOC_IrqEn>(1);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::Err_IrqEn>(1);
+    _mmio_cdma.control<Mmio_cdma::CDMACR::Key_Hole_Read>(keyhole_read);
+    _mmio_cdma.commit_control();
 
     // write source address
     _mmio_cdma.write<Mmio_cdma::SA>((uint32_t) src);
-    _mmio_cdma.write<Mmio_cdma::SA_MSB>((uint32_t) (src<<32));    
+    if(PROFILE::addr_64)
+        _mmio_cdma.write<Mmio_cdma::SA_MSB>((uint32_t) (src>>32));
 
     // write destination address
     _mmio_cdma.write<Mmio_cdma::DA>((uint32_t) dst);
-    _mmio_cdma.write<Mmio_cdma::DA_MSB>((uint32_t) (dst<<32));    
+    if(PROFILE::addr_64)
+        _mmio_cdma.write<Mmio_cdma::DA_MSB>((uint32_t) (dst>>32));
 
     // write bytes to transfer. This starts the transfer.
     _mmio_cdma.write<Mmio_cdma::BTT>(btt);
 
-    // waiting for interrupt
-    sig_rec.wait_for_signal();
+    Completion completion = wait_for_completion(btt, 0);
 
 	#if defined(DEBUG)
     Genode::log("Registers after simple_memcpy:");
     print_registers();
     #endif
+
+    return completion;
+}
+
+
+template <typename PROFILE>
+void Driver::multiple_simple_memcpy(Destinations const &dst, Genode::uint64_t src, Genode::size_t size,
+                                    Range &failed, bool keyhole_read)
+{
+	#if defined(DEBUG) || defined(VERBOSE)
+    Genode::log("multiple_simple_memcpy(", Hex(dst.addr[0]), " (", dst.count, "), ", Hex(src), ", ", Hex(size), ")");
+    #endif
     
-    // got interrupt, because the CDMA IP core successfully copied
-    if(_mmio_cdma.read<Mmio_cdma::CDMASR::IOC_Irq>())
-    {
-        _mmio_cdma.write<Mmio_cdma::CDMASR::IOC_Irq>(1); // clear interrupt
-        _irq.ack_irq();        
-    }
-    // otherwise it is an error interrupt
-    else if(_mmio_cdma.read<Mmio_cdma::CDMASR::Err_Irq>())
+    Genode::size_t const chunk_size = _limits.chunk_size;
+    for(Genode::size_t offset = 0; offset < size; offset += chunk_size)
     {
-        _mmio_cdma.write<Mmio_cdma::CDMASR::Err_Irq>(1); // clear interrupt
-        _irq.ack_irq();        
+        Genode::size_t btt = min(size - offset, chunk_size);
+        Genode::uint64_t chunk_src = keyhole_read ? src : src + offset;
 
-        // is it an internal error?
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::DMAIntErr>())
+        // every chunk is resubmitted on its own. `simple_memcpy` resets the
+        // CDMA IP core before programming it.
+        Completion completion = COMPLETE;
+        for(unsigned i = 0; i < dst.count && completion == COMPLETE; i++)
         {
-            Genode::error("A internal error has been encountered by the DataMover ",
-                          "on the data transport channel.");
-            throw Cdma::Internal_memcpy_error();
+            completion = simple_memcpy<PROFILE>(dst.addr[i]+offset, chunk_src, btt, keyhole_read);
+            for(unsigned retry = 0; completion != COMPLETE && retry < _retries; retry++)
+            {
+                Genode::warning("CDMA transfer failed, resubmit ", Hex(btt), " bytes.");
+                completion = simple_memcpy<PROFILE>(dst.addr[i]+offset, chunk_src, btt, keyhole_read);
+            }
         }
 
-        // is it a slave error?
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::DMASlvErr>())
+        if(completion == COMPLETE)
         {
-            Genode::error("AXI slave error response has been received by the ",
-                          "AXI DataMover during an AXI transfer.");
-            throw Cdma::Internal_memcpy_error();
+            unsigned const chunk = offset / chunk_size + 1;
+            if(_progress_interval && chunk % _progress_interval == 0)
+                report_progress(offset + btt);
         }
-
-        // is it a decode error?
-        if(_mmio_cdma.read<Mmio_cdma::CDMASR::DMADecErr>())
+        else
         {
-            Genode::error("An AXI decode error has been received by the AXI DataMover. ",
-                          "This error occurs if the DataMover issues an address request ",
-                          "to an invalid location.");
-            throw Cdma::Invalid_memcpy_address();
+            // all chunks in front of this one are copied.
+            failed.offset = offset;
+            failed.size = size - offset;
+            reset();
+            throw_error(completion);
         }
-    } else {
-        // this should never ever happen.
-        Genode::error("Got interrupt from unknown source.");
-        throw Cdma::Internal_memcpy_error();            
     }
-    
 }
 
 
-void Driver::multiple_simple_memcpy(Genode::uint64_t dst, Genode::uint64_t src, Genode::size_t size)
+bool Driver::is_idle()
 {
-	#if defined(DEBUG) || defined(VERBOSE)
-    Genode::log("multiple_simple_memcpy(", Hex(dst), ", ", Hex(src), ", ", Hex(size), ")");
-    #endif
-    
-    Genode::size_t btt;  // bytes to copy
-    Genode::uint64_t offset = 0;
-    do
-    {
-        if(size >= MAX_BTT)
-        {
-            btt = MAX_BTT;
-            size -= MAX_BTT;
-        } else {
-            btt = size;
-            size = 0;
-        }
-        simple_memcpy(dst+offset, src+offset, btt);
-        offset += btt;
-    } while(size > 0);
+    return _mmio_cdma.read<Mmio_cdma::CDMASR::Idle>();
 }
 
+void Driver::reset()
+{
+    _mmio_cdma.reset_control();
+}
 
-bool Driver::is_idle()
+
+template <typename PROFILE>
+Driver::Engine const &Driver::engine()
 {
-    return _mmio_cdma.read<Mmio_cdma::CDMASR::Idle>();
+    static Engine const engine {
+        &Driver::run_transfer<PROFILE>,
+        &Driver::run_batch<PROFILE>,
+        &Driver::run_stride<PROFILE> };
+    return engine;
 }
 
-void Driver::reset()
+
+template <bool SG, bool ADDR_64>
+Driver::Engine const &Driver::select_engine(bool dre, unsigned data_width)
 {
-    _mmio_cdma.write<Mmio_cdma::CDMACR::Reset>(0x1);
+    // with DRE, the addresses need no alignment to the data width
+    if(dre)
+        return engine<Profile<SG, ADDR_64, true, 1>>();
+
+    switch(data_width)
+    {
+    case 4:  return engine<Profile<SG, ADDR_64, false, 4>>();
+    case 8:  return engine<Profile<SG, ADDR_64, false, 8>>();
+    case 16: return engine<Profile<SG, ADDR_64, false, 16>>();
+    case 32: return engine<Profile<SG, ADDR_64, false, 32>>();
+    case 64: return engine<Profile<SG, ADDR_64, false, 64>>();
+    default: return engine<Profile<SG, ADDR_64, false, 128>>();
+    }
+}
+
+
+Driver::Engine const &Driver::select_engine(bool sg, Hardware const &hardware)
+{
+    switch((sg ? 2 : 0) | (hardware.addr_64 ? 1 : 0))
+    {
+    case 0: return select_engine<false, false>(hardware.dre, hardware.data_width);
+    case 1: return select_engine<false, true>(hardware.dre, hardware.data_width);
+    case 2: return select_engine<true,  false>(hardware.dre, hardware.data_width);
+    default: return select_engine<true,  true>(hardware.dre, hardware.data_width);
+    }
 }
 
 
 Driver& Driver::factory(Genode::Env &env,
                         Genode::addr_t cdma_address,
                         Genode::uint32_t irq_number,
-                        bool sg_enabled)
+                        bool sg_enabled,
+                        unsigned timeout_ms,
+                        unsigned retries,
+                        Genode::size_t max_btt,
+                        bool calibrate,
+                        Hardware const &hardware)
+{
+    static Driver driver(env, cdma_address, irq_number, sg_enabled,
+                         timeout_ms, retries, max_btt, calibrate, hardware);
+    return driver;
+}
+
+
+Driver& Driver::factory(Genode::Env &env, Genode::Xml_node const &config)
 {
-    static Driver driver(env, cdma_address, irq_number, sg_enabled);
+    Genode::addr_t cdma_address = 0;
+    Genode::uint32_t irq_number = 0;
+    bool sg_enabled = true;
+
+    // parse physical base address of CDMA 
+    config.attribute("address").value(&cdma_address);
+    config.attribute("irq").value(&irq_number);
+
+    // is scather gather mode enabled?
+    sg_enabled = config.attribute_value("sg_enabled", sg_enabled);
+
+    // watchdog and error recovery
+    unsigned const timeout_ms = config.attribute_value("timeout_ms", 1000U);
+    unsigned const retries = config.attribute_value("retries", 2U);
+
+    // transfer limits, the width of the BTT register of the design
+    Genode::size_t max_btt = config.attribute_value("max_btt", Genode::Number_of_bytes(0));
+    unsigned const width = config.attribute_value("btt_width", 0U);
+    if(width && (width < MIN_BTT_WIDTH || width > MAX_BTT_WIDTH))
+        Genode::warning("Invalid BTT width ", width, ", the BTT register has ",
+                        MIN_BTT_WIDTH, " to ", MAX_BTT_WIDTH, " bits.");
+    else if(width && !max_btt)
+        max_btt = (1UL << width) - 1;
+    bool const calibrate = config.attribute_value("calibrate", false);
+
+    // properties of the hardware design, which select the register
+    // sequences of the driver
+    Hardware hardware;
+    hardware.addr_64 = config.attribute_value("address_width", 32U) > 32;
+    hardware.dre = config.attribute_value("dre", hardware.dre);
+    unsigned const data_width = config.attribute_value("data_width", 32U);
+    if(data_width < 32 || data_width > 1024 || (data_width & (data_width - 1)))
+        Genode::warning("Invalid data width ", data_width, ", assume 32 bit.");
+    else
+        hardware.data_width = data_width / 8;
+
+    // global bandwidth limit
+    Throttle throttle;
+    throttle.bandwidth = config.attribute_value("bandwidth", Genode::Number_of_bytes(0));
+    throttle.slice_us = config.attribute_value("slice_us", throttle.slice_us);
+    throttle.duty = Genode::min(config.attribute_value("duty", throttle.duty), 100U);
+
+	#if defined(DEBUG)
+    Genode::log("CDMA Address: ", Hex(cdma_address));
+    Genode::log("CDMA Interrupt: ", irq_number);
+    Genode::log("Scather/Gather: ", sg_enabled ? "enabled" : "disabled");                        
+	#endif
+
+    Driver &driver = factory(env, cdma_address, irq_number, sg_enabled, timeout_ms,
+                             retries, max_btt, calibrate, hardware);
+    driver.throttle(throttle);
     return driver;
 }
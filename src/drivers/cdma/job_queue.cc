@@ -0,0 +1,116 @@
+/*
+ * \brief  Thread which runs queued CDMA jobs one after another
+ * \author Johannes Fischer
+ * \date   2019-10-11
+ */
+
+
+#include <cdma/job_queue.h>
+
+using namespace Cdma;
+
+
+Job_queue::Job_queue(Genode::Env &env, Genode::Thread::Name const &name)
+    :
+    Genode::Thread(env, name, STACK_SIZE)
+{
+    start();
+}
+
+
+void Job_queue::submit(Job &job)
+{
+    {
+        Genode::Lock::Guard guard(_lock);
+        job._pending = true;
+        job._released = false;
+        _jobs.insert(&job, _tail);
+        _tail = &job;
+        _pending++;
+    }
+    _submitted.up();
+}
+
+
+bool Job_queue::cancel(Job &job)
+{
+    Genode::Lock::Guard guard(_lock);
+    if(!job._pending)
+        return true;
+
+    // a queued job is simply removed. Its semaphore count is consumed by the
+    // thread, which finds an empty list.
+    Job *prev = nullptr;
+    for(Job *j = _jobs.first(); j; prev = j, j = j->next())
+    {
+        if(j != &job)
+            continue;
+
+        _jobs.remove(j);
+        if(_tail == j)
+            _tail = prev;
+        job._pending = false;
+        if(!--_pending)
+            for(; _joiners; _joiners--)
+                _idle.up();
+        return true;
+    }
+
+    // the job is executed right now, the caller must not wait for it
+    job._released = true;
+    return false;
+}
+
+
+void Job_queue::join()
+{
+    {
+        Genode::Lock::Guard guard(_lock);
+        if(!_pending)
+            return;
+        _joiners++;
+    }
+    _idle.down();
+}
+
+
+void Job_queue::entry()
+{
+    while(true)
+    {
+        _submitted.down();
+
+        Job *job;
+        {
+            Genode::Lock::Guard guard(_lock);
+            job = _jobs.first();
+            if(!job)
+                continue;
+
+            _jobs.remove(job);
+            if(job == _tail)
+                _tail = nullptr;
+        }
+
+        job->execute();
+
+        bool released;
+        {
+            Genode::Lock::Guard guard(_lock);
+            job->_pending = false;
+            released = job->_released;
+            if(!released)
+                job->completed();
+
+            // wake up everyone waiting for an idle queue
+            if(!--_pending)
+                for(; _joiners; _joiners--)
+                    _idle.up();
+        }
+
+        // the owner of a job, which is not released, may destroy it as soon
+        // as the queue is unlocked
+        if(released)
+            job->release();
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * \brief  CDMA session which runs the driver in the component of the client
+ * \author Johannes Fischer
+ * \date   2019-10-14
+ */
+
+
+#include <cdma/local_session.h>
+
+using namespace Cdma;
+
+
+Local_session::Local_session(Genode::Env &env, Genode::Allocator &alloc,
+                             Driver &driver, Throttle const &throttle)
+    :
+    Blocking_session(env),
+    _driver(driver),
+    _throttle(throttle),
+    _phys_cache(alloc)
+{ }
+
+
+void Local_session::memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size)
+{
+    _transfer([&] () {
+        _driver.memcpy(dst, src, size, &_failed, &_progress, _progress_interval,
+                       _throttle); });
+}
+
+
+void Local_session::memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size)
+{
+    _transfer([&] () { _driver.memset(dst, value, size, &_failed, _throttle); });
+}
+
+
+void Local_session::copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+                         Genode::Dataspace_capability src, Genode::off_t src_offset,
+                         Genode::size_t size)
+{
+    Genode::addr_t const dst_addr = _phys_cache.resolve(dst, dst_offset, size);
+    Genode::addr_t const src_addr = _phys_cache.resolve(src, src_offset, size);
+    memcpy(dst_addr, src_addr, size);
+}
+
+
+void Local_session::invalidate(Genode::Dataspace_capability ds)
+{
+    _phys_cache.invalidate(ds);
+}
+
+
+void Local_session::fanout(Destinations dst, Genode::addr_t src, Genode::size_t size)
+{
+    _transfer([&] () { _driver.fanout(dst, src, size, &_failed, _throttle); });
+}
+
+
+void Local_session::stride(Stride stride)
+{
+    _transfer([&] () {
+        _driver.stride(stride.dst, stride.dst_pitch, stride.src, stride.src_pitch,
+                       stride.row_size, stride.rows, &_failed, _throttle); });
+}
+
+
+void Local_session::batch(unsigned count)
+{
+    _transfer([&] () { _driver.batch(_batch.copy, count, &_failed, _throttle); });
+}
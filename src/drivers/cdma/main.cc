@@ -6,16 +6,21 @@
 
 #include <cdma_session/cdma_session.h>
 #include <base/attached_rom_dataspace.h>
+#include <base/attached_ram_dataspace.h>
 
 #include <base/component.h>
 #include <base/log.h>
 #include <base/heap.h>
+#include <base/ram_allocator.h>
+#include <base/quota_guard.h>
 #include <root/component.h>
 #include <base/rpc_server.h>
 #include <base/stdint.h>
 
 #include <cdma/cdma.h>
 #include <cdma/driver.h>
+#include <cdma/phys_cache.h>
+#include <cdma/job_queue.h>
 
 namespace Cdma {
 	struct Session_component;
@@ -24,23 +29,252 @@ namespace Cdma {
 };
 
 
-struct Cdma::Session_component : Genode::Rpc_object<Session>
+struct Cdma::Session_component : Genode::Rpc_object<Session>, Job_queue::Job
 {
 private:
 
+    Genode::Allocator &_alloc;
     Driver &_driver;
+    Job_queue &_worker;
+
+    // the dataspaces and the heap of the session are allocated from the
+    // quota donated by the client, not from the quota of the driver
+    Genode::Ram_quota_guard _ram_guard;
+    Genode::Cap_quota_guard _cap_guard;
+    Genode::Constrained_ram_allocator _ram;
+    Genode::Heap _heap;
+
+    // request, which is queued at the worker. A session runs one request at
+    // a time, the entrypoint rejects another one until it completed.
+    struct Request
+    {
+        enum Op { MEMCPY, MEMSET, FANOUT, BATCH, STRIDE };
+
+        Op op;
+        Destinations dst;
+        Genode::addr_t src;
+        Genode::size_t size;
+        Genode::uint8_t value;
+        unsigned count;
+        Stride stride;
+    };
+    Request _request;
+
+    // completion of the last request
+    Genode::Signal_context_capability _completion_sigh;
+    Status volatile _status = SUCCESS;
+
+    // range which was not copied by the last failed memcpy
+    Range _failed { 0, 0 };
+
+    // completion cursor shared with the client
+    Genode::Attached_ram_dataspace _progress_ds;
+    Progress &_progress;
+    unsigned _progress_interval = 0;
+
+    // list of copies shared with the client
+    Genode::Attached_ram_dataspace _batch_ds;
+    Batch &_batch;
+
+    // bandwidth limit requested by the client
+    Throttle const _throttle;
+
+    // physical ranges of the dataspaces of capability-based copies
+    Phys_cache _phys_cache;
+
+    /**
+     * Queue `request` at the worker. A client, which submits a request
+     * before the previous one completed, gets `Session_busy`. Waiting for
+     * the worker would stall the entrypoint and thereby all other sessions.
+     */
+    void _submit(Request const &request)
+    {
+        if(!_driver.is_supported())
+            throw Cdma::Function_unsupported();
+
+        if(pending())
+            throw Cdma::Session_busy();
+
+        _request = request;
+        _failed = Range { 0, 0 };
+        _status = PENDING;
+        _worker.submit(*this);
+    }
+
+    /**
+     * Run the request. Executed by the thread of the worker.
+     */
+    void execute() override
+    {
+        Request const &r = _request;
+        Status status = SUCCESS;
+        try {
+            switch(r.op)
+            {
+            case Request::MEMCPY:
+                _driver.memcpy(r.dst.addr[0], r.src, r.size, &_failed, &_progress,
+                               _progress_interval, _throttle);
+                break;
+            case Request::MEMSET:
+                _driver.memset(r.dst.addr[0], r.value, r.size, &_failed, _throttle);
+                break;
+            case Request::FANOUT:
+                _driver.fanout(r.dst, r.src, r.size, &_failed, _throttle);
+                break;
+            case Request::BATCH:
+                _driver.batch(_batch.copy, r.count, &_failed, _throttle);
+                break;
+            case Request::STRIDE:
+                _driver.stride(r.stride.dst, r.stride.dst_pitch, r.stride.src,
+                               r.stride.src_pitch, r.stride.row_size, r.stride.rows,
+                               &_failed, _throttle);
+                break;
+            }
+        }
+        catch(Cdma::Function_unsupported)   { status = FUNCTION_UNSUPPORTED; }
+        catch(Cdma::Invalid_memcpy_address) { status = INVALID_MEMCPY_ADDRESS; }
+        catch(Cdma::Memcpy_timeout)         { status = MEMCPY_TIMEOUT; }
+        catch(Cdma::Exception)              { status = INTERNAL_MEMCPY_ERROR; }
+
+        _status = status;
+    }
+
+    /**
+     * Signal the completion, after which the client may submit the next
+     * request
+     */
+    void completed() override
+    {
+        if(_completion_sigh.valid())
+            Genode::Signal_transmitter(_completion_sigh).submit();
+    }
 
 public:
-    Session_component(Driver &driver)
-		: _driver(driver) {}
+
+    /**
+     * RAM quota of a session besides the session object: the progress and
+     * batch dataspaces and the heap of the physical-address cache. The
+     * cache holds few small entries, which fit the smallest chunk of the
+     * heap (4K machine words) plus a page of meta data.
+     */
+    static Genode::size_t ram_quota()
+    {
+        return Genode::align_addr(sizeof(Progress), 12)
+             + Genode::align_addr(sizeof(Batch), 12)
+             + 4*1024*sizeof(Genode::addr_t) + 4096;
+    }
+
+    /**
+     * @exception Out_of_ram  The donated quota does not cover the session
+     * @exception Out_of_caps The donated caps do not cover the session
+     */
+    Session_component(Genode::Env &env, Genode::Allocator &alloc, Driver &driver,
+                      Job_queue &worker, Throttle const &throttle,
+                      Genode::Ram_quota ram_quota, Genode::Cap_quota cap_quota)
+		:
+        _alloc(alloc),
+        _driver(driver),
+        _worker(worker),
+        _ram_guard(ram_quota),
+        _cap_guard(cap_quota),
+        _ram(env.ram(), _ram_guard, _cap_guard),
+        _heap(_ram, env.rm()),
+        _progress_ds(_ram, env.rm(), sizeof(Progress)),
+        _progress(*_progress_ds.local_addr<Progress>()),
+        _batch_ds(_ram, env.rm(), sizeof(Batch)),
+        _batch(*_batch_ds.local_addr<Batch>()),
+        _throttle(throttle),
+        _phys_cache(_heap)
+        {}
+
+    /**
+     * A session closed during a transfer is destroyed by the worker
+     */
+    void release() override {
+        Genode::destroy(_alloc, this);
+    }
+
+    virtual void completion_sigh(Genode::Signal_context_capability sigh) {
+        _completion_sigh = sigh;
+    }
+
+    virtual Status result() {
+        return _status;
+    }
 
     virtual void memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size) {
-        _driver.memcpy(dst, src, size);
+        Request r { };
+        r.op = Request::MEMCPY; r.dst = Destinations { { dst }, 1 }; r.src = src; r.size = size;
+        _submit(r);
+    }
+
+    virtual void copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+                      Genode::Dataspace_capability src, Genode::off_t src_offset,
+                      Genode::size_t size) {
+        // the addresses are resolved by the entrypoint, such that an invalid
+        // range is reported right away
+        Genode::addr_t const dst_addr = _phys_cache.resolve(dst, dst_offset, size);
+        Genode::addr_t const src_addr = _phys_cache.resolve(src, src_offset, size);
+        memcpy(dst_addr, src_addr, size);
+    }
+
+    virtual void invalidate(Genode::Dataspace_capability ds) {
+        _phys_cache.invalidate(ds);
+    }
+
+    virtual void fanout(Destinations dst, Genode::addr_t src, Genode::size_t size) {
+        if(!dst.count || dst.count > Destinations::MAX)
+            throw Cdma::Invalid_memcpy_address();
+
+        Request r { };
+        r.op = Request::FANOUT; r.dst = dst; r.src = src; r.size = size;
+        _submit(r);
+    }
+
+    virtual void stride(Stride stride) {
+        Request r { };
+        r.op = Request::STRIDE; r.stride = stride;
+        _submit(r);
+    }
+
+    virtual Genode::Dataspace_capability batch_dataspace() {
+        return _batch_ds.cap();
+    }
+
+    virtual void batch(unsigned count) {
+        if(count > Batch::MAX)
+            throw Cdma::Invalid_memcpy_address();
+
+        Request r { };
+        r.op = Request::BATCH; r.count = count;
+        _submit(r);
+    }
+
+    virtual Genode::Dataspace_capability progress_dataspace() {
+        return _progress_ds.cap();
+    }
+
+    virtual void progress_interval(unsigned descriptors) {
+        _progress_interval = descriptors;
+    }
+
+    virtual void memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size) {
+        Request r { };
+        r.op = Request::MEMSET; r.dst = Destinations { { dst }, 1 }; r.value = value; r.size = size;
+        _submit(r);
+    }
+
+    virtual Range failed_range() {
+        return _failed;
     }
 
     virtual bool is_supported() {
         return _driver.is_supported();
     }
+
+    virtual Limits limits() {
+        return _driver.limits();
+    }
   
 };
 
@@ -49,30 +283,58 @@ class Cdma::Root_component : public Genode::Root_component<Cdma::Session_compone
 {
 private:
 
+    Genode::Env &_env;
     Driver &_driver;
+    Job_queue &_worker;
 
 protected:
 
     Session_component *_create_session(const char *args)
 		{
-			Genode::size_t ram_quota = Genode::Arg_string::find_arg(args, "ram_quota").ulong_value(0);
+			// the root already deducted the session object from the quota
+			Genode::Ram_quota const ram_quota = Genode::ram_quota_from_args(args);
+			Genode::Cap_quota const cap_quota = Genode::cap_quota_from_args(args);
 
-			if (ram_quota < sizeof(Session_component)) {
-                Genode::warning("Insufficient dontated ram_quota (", ram_quota, " bytes), "
-                                "require ", sizeof(Session_component), " bytes");
+			if (ram_quota.value < Session_component::ram_quota()) {
+                Genode::error("Insufficient donated ram_quota (", ram_quota.value, " bytes), "
+                              "require ", Session_component::ram_quota(), " bytes");
+                throw Genode::Insufficient_ram_quota();
 			}
             
-			return new (md_alloc()) Session_component(_driver);
+            // optional bandwidth limit of the session
+            Throttle throttle;
+            throttle.bandwidth = Genode::Arg_string::find_arg(args, "bandwidth").ulong_value(0);
+            throttle.slice_us = Genode::Arg_string::find_arg(args, "slice_us").ulong_value(throttle.slice_us);
+            throttle.duty = Genode::Arg_string::find_arg(args, "duty").ulong_value(throttle.duty);
+
+            try {
+                return new (md_alloc()) Session_component(_env, *md_alloc(), _driver, _worker,
+                                                          throttle, ram_quota, cap_quota);
+            }
+            catch(Genode::Out_of_ram)  { throw Genode::Insufficient_ram_quota(); }
+            catch(Genode::Out_of_caps) { throw Genode::Insufficient_cap_quota(); }
 		}
 
+    void _destroy_session(Session_component *session) override
+    {
+        // the worker must not run a request of a closed session. A running
+        // one is not awaited, the worker destroys the session afterwards.
+        if(_worker.cancel(*session))
+            Genode::destroy(md_alloc(), session);
+    }
+
 public:
 
-    Root_component(Genode::Entrypoint &ep,
+    Root_component(Genode::Env &env,
+                   Genode::Entrypoint &ep,
                    Genode::Allocator &alloc,
-                   Driver &driver)
+                   Driver &driver,
+                   Job_queue &worker)
         :
         Genode::Root_component<Cdma::Session_component>(ep, alloc),
-        _driver(driver)
+        _env(env),
+        _driver(driver),
+        _worker(worker)
         {
 			#if defined(DEBUG)
 			Genode::log("creating root component");
@@ -93,43 +355,19 @@ struct Cdma::Main
 		env(env)
         {
 
-            /*
-             * Read config
-             */
-            Genode::addr_t cdma_address = 0;
-            Genode::uint32_t irq_number = 0;
-            bool sg_enabled = true;
-
-            // parse physical base address of CDMA 
-            Genode::Xml_node cdma_node = config_rom.xml().sub_node("cdma");
-            cdma_node.attribute("address").value(&cdma_address);
-            cdma_node.attribute("irq").value(&irq_number);
-            
-            try {
-                // is scather gather mode enabled?
-                cdma_node.attribute("sg_enabled").value(&sg_enabled);
-            }
-            catch (Genode::Xml_node::Nonexistent_attribute) {}
-
-			#if defined(DEBUG)
-            Genode::log("CDMA Address: ", Hex(cdma_address));
-            Genode::log("CDMA Interrupt: ", irq_number);
-            Genode::log("Scather/Gather: ", sg_enabled ? "enabled" : "disabled");                        
-			#endif
-
             /*
              * Create Driver
              */
-            Cdma::Driver &driver = Cdma::Driver::factory(
-                env,
-                cdma_address,
-                irq_number,
-                sg_enabled);
+            Cdma::Driver &driver =
+                Cdma::Driver::factory(env, config_rom.xml().sub_node("cdma"));
 
             /*
              * Announce service
              */
-            static Cdma::Root_component root(env.ep(), sliced_heap, driver);
+            // transfers run in their own thread, the entrypoint only queues
+            // them
+            static Cdma::Job_queue worker(env, "cdma worker");
+            static Cdma::Root_component root(env, env.ep(), sliced_heap, driver, worker);
             env.parent().announce(env.ep().manage(root));
 
         }
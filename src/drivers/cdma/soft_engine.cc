@@ -0,0 +1,289 @@
+/*
+ * \brief  Parallel copy by the CPU cores, used if the CDMA is missing
+ * \author Johannes Fischer
+ * \date   2019-10-15
+ */
+
+
+#include <cdma/soft_engine.h>
+#include <util/string.h>
+#include <util/misc_math.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Cdma;
+
+
+Soft_engine::Worker::Worker(Genode::Env &env, Soft_engine &engine,
+                            Genode::Thread::Name const &name,
+                            Genode::Affinity::Location location)
+    :
+    Genode::Thread(env, name, STACK_SIZE, location, Genode::Thread::Weight(), env.cpu()),
+    _engine(engine)
+{
+    start();
+}
+
+
+void Soft_engine::Worker::start_part(Part const &part)
+{
+    _part = part;
+    _started.up();
+}
+
+
+void Soft_engine::Worker::entry()
+{
+    while(true)
+    {
+        _started.down();
+        _run(_part);
+        _engine._finished.up();
+    }
+}
+
+
+Soft_engine::Soft_engine(Genode::Env &env, Genode::Allocator &alloc, unsigned threads)
+    :
+    _alloc(alloc)
+{
+    Genode::Affinity::Space const space = env.cpu().affinity_space();
+    unsigned const cpus = Genode::max(space.total(), 1U);
+    if(!threads)
+        threads = cpus;
+
+    // the calling thread copies a part as well
+    _count = threads - 1;
+    _workers = _count ? (Worker **)alloc.alloc(_count*sizeof(Worker *)) : nullptr;
+
+    // the workers start behind the first CPU, which runs the caller
+    for(unsigned i = 0; i < _count; i++)
+    {
+        unsigned const cpu = (i + 1) % cpus;
+        Genode::Affinity::Location const location(cpu % space.width(), cpu / space.width());
+        _workers[i] = new (alloc) Worker(env, *this, Genode::Thread::Name("cdma soft ", i),
+                                         location);
+    }
+
+    Genode::log("CDMA software engine with ", threads, " threads");
+}
+
+
+Soft_engine::~Soft_engine()
+{
+    for(unsigned i = 0; i < _count; i++)
+        Genode::destroy(_alloc, _workers[i]);
+    if(_workers)
+        _alloc.free(_workers, _count*sizeof(Worker *));
+}
+
+
+Soft_engine &Soft_engine::factory(Genode::Env &env, Genode::Allocator &alloc,
+                                  unsigned threads)
+{
+    static Soft_engine engine(env, alloc, threads);
+    return engine;
+}
+
+
+void Soft_engine::_run(Part const &part)
+{
+    if(part.src)
+        copy_kernel(part.dst, part.src, part.size);
+    else
+        set_kernel(part.dst, part.value, part.size);
+}
+
+
+void Soft_engine::_split(Part const &part)
+{
+    unsigned const parts = (unsigned)Genode::min((Genode::size_t)_count + 1,
+                                                 part.size / PART_MIN);
+    if(parts < 2)
+    {
+        _run(part);
+        return;
+    }
+
+    Genode::Lock::Guard guard(_lock);
+
+    // parts are whole pages, the caller takes the remainder
+    Genode::size_t const part_size = Genode::align_addr(part.size / parts, 12);
+    Genode::size_t offset = 0;
+    unsigned started = 0;
+    for(; started < parts - 1 && offset + part_size < part.size; started++)
+    {
+        Part const p { (char *)part.dst + offset,
+                       part.src ? (char const *)part.src + offset : nullptr,
+                       part_size, part.value };
+        _workers[started]->start_part(p);
+        offset += part_size;
+    }
+
+    _run(Part { (char *)part.dst + offset,
+                part.src ? (char const *)part.src + offset : nullptr,
+                part.size - offset, part.value });
+
+    for(unsigned i = 0; i < started; i++)
+        _finished.down();
+}
+
+
+void Soft_engine::copy(void *dst, void const *src, Genode::size_t size)
+{
+    _split(Part { dst, src, size, 0 });
+}
+
+
+void Soft_engine::set(void *dst, Genode::uint8_t value, Genode::size_t size)
+{
+    _split(Part { dst, nullptr, size, value });
+}
+
+
+void Soft_engine::copy_kernel(void *dst, void const *src, Genode::size_t size)
+{
+    Genode::uint8_t *d = (Genode::uint8_t *)dst;
+    Genode::uint8_t const *s = (Genode::uint8_t const *)src;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    // four quad registers per iteration fill a cache line of the
+    // Cortex-A9 with a single burst
+    Genode::size_t const blocks = size / 64;
+
+    for(Genode::size_t i = 0; i < blocks; i++, d += 64, s += 64)
+    {
+        uint8x16_t const a = vld1q_u8(s);
+        uint8x16_t const b = vld1q_u8(s + 16);
+        uint8x16_t const c = vld1q_u8(s + 32);
+        uint8x16_t const e = vld1q_u8(s + 48);
+        vst1q_u8(d, a);
+        vst1q_u8(d + 16, b);
+        vst1q_u8(d + 32, c);
+        vst1q_u8(d + 48, e);
+    }
+    Genode::memcpy(d, s, size % 64);
+#elif defined(__SSE2__)
+    // non-temporal stores require an aligned destination
+    Genode::size_t const head = Genode::min((Genode::size_t)(-(Genode::addr_t)d & 15), size);
+    Genode::memcpy(d, s, head);
+    d += head; s += head; size -= head;
+
+    Genode::size_t const blocks = size / 64;
+    for(Genode::size_t i = 0; i < blocks; i++, d += 64, s += 64)
+    {
+        asm volatile("movdqu    (%0), %%xmm0\n"
+                     "movdqu  16(%0), %%xmm1\n"
+                     "movdqu  32(%0), %%xmm2\n"
+                     "movdqu  48(%0), %%xmm3\n"
+                     "movntdq %%xmm0,   (%1)\n"
+                     "movntdq %%xmm1, 16(%1)\n"
+                     "movntdq %%xmm2, 32(%1)\n"
+                     "movntdq %%xmm3, 48(%1)\n"
+                     : : "r" (s), "r" (d)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    }
+    asm volatile("sfence" : : : "memory");
+    Genode::memcpy(d, s, size % 64);
+#else
+    Genode::memcpy(d, s, size);
+#endif
+}
+
+
+void Soft_engine::set_kernel(void *dst, Genode::uint8_t value, Genode::size_t size)
+{
+    Genode::uint8_t *d = (Genode::uint8_t *)dst;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    uint8x16_t const v = vdupq_n_u8(value);
+    Genode::size_t const blocks = size / 64;
+
+    for(Genode::size_t i = 0; i < blocks; i++, d += 64)
+    {
+        vst1q_u8(d, v);
+        vst1q_u8(d + 16, v);
+        vst1q_u8(d + 32, v);
+        vst1q_u8(d + 48, v);
+    }
+    Genode::memset(d, value, size % 64);
+#elif defined(__SSE2__)
+    Genode::size_t const head = Genode::min((Genode::size_t)(-(Genode::addr_t)d & 15), size);
+    Genode::memset(d, value, head);
+    d += head; size -= head;
+
+    // the value is replicated over a register from a 16-byte pattern
+    Genode::uint8_t pattern[16];
+    Genode::memset(pattern, value, sizeof(pattern));
+
+    Genode::size_t const blocks = size / 64;
+    for(Genode::size_t i = 0; i < blocks; i++, d += 64)
+    {
+        asm volatile("movdqu  (%1), %%xmm0\n"
+                     "movntdq %%xmm0,   (%0)\n"
+                     "movntdq %%xmm0, 16(%0)\n"
+                     "movntdq %%xmm0, 32(%0)\n"
+                     "movntdq %%xmm0, 48(%0)\n"
+                     : : "r" (d), "r" (pattern) : "memory", "xmm0");
+    }
+    asm volatile("sfence" : : : "memory");
+    Genode::memset(d, value, size % 64);
+#else
+    Genode::memset(d, value, size);
+#endif
+}
+
+
+bool Soft_engine::zero_kernel(void const *src, Genode::size_t size)
+{
+    Genode::uint8_t const *s = (Genode::uint8_t const *)src;
+    Genode::size_t const blocks = size / 64;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    for(Genode::size_t i = 0; i < blocks; i++, s += 64)
+    {
+        uint8x16_t const a = vorrq_u8(vld1q_u8(s), vld1q_u8(s + 16));
+        uint8x16_t const b = vorrq_u8(vld1q_u8(s + 32), vld1q_u8(s + 48));
+        uint64x2_t const v = vreinterpretq_u64_u8(vorrq_u8(a, b));
+        if(vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1))
+            return false;
+    }
+#elif defined(__SSE2__)
+    for(Genode::size_t i = 0; i < blocks; i++, s += 64)
+    {
+        // a byte mask of 0xffff means that all bytes compared equal to zero
+        unsigned mask;
+        asm volatile("movdqu    (%1), %%xmm0\n"
+                     "movdqu  16(%1), %%xmm1\n"
+                     "movdqu  32(%1), %%xmm2\n"
+                     "movdqu  48(%1), %%xmm3\n"
+                     "por     %%xmm1, %%xmm0\n"
+                     "por     %%xmm3, %%xmm2\n"
+                     "por     %%xmm2, %%xmm0\n"
+                     "pxor    %%xmm1, %%xmm1\n"
+                     "pcmpeqb %%xmm1, %%xmm0\n"
+                     "pmovmskb %%xmm0, %0\n"
+                     : "=r" (mask) : "r" (s)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+        if(mask != 0xffff)
+            return false;
+    }
+#else
+    for(Genode::size_t i = 0; i < blocks; i++, s += 64)
+    {
+        unsigned long const *w = (unsigned long const *)s;
+        unsigned long v = 0;
+        for(unsigned j = 0; j < 64 / sizeof(unsigned long); j++)
+            v |= w[j];
+        if(v)
+            return false;
+    }
+#endif
+
+    for(Genode::size_t i = 0; i < size % 64; i++)
+        if(s[i])
+            return false;
+    return true;
+}
@@ -0,0 +1,203 @@
+/*
+ * \brief  CDMA session which copies with the CPU cores
+ * \author Johannes Fischer
+ * \date   2019-10-15
+ */
+
+
+#include <cdma/soft_session.h>
+#include <dataspace/client.h>
+#include <cpu/memory_barrier.h>
+
+using namespace Cdma;
+
+
+Soft_session::Soft_session(Genode::Env &env, Genode::Allocator &alloc, Soft_engine &engine)
+    :
+    Blocking_session(env),
+    _env(env),
+    _alloc(alloc),
+    _engine(engine)
+{ }
+
+
+Soft_session::~Soft_session()
+{
+    while(Attachment *a = _attachments.first())
+        _remove(*a);
+}
+
+
+Soft_session::Attachment &Soft_session::_attachment(Genode::Dataspace_capability ds)
+{
+    if(!ds.valid())
+        throw Cdma::Invalid_memcpy_address();
+
+    Genode::Lock::Guard guard(_attachments_lock);
+    for(Attachment *a = _attachments.first(); a; a = a->next())
+        if(a->cap == ds)
+            return *a;
+
+    Genode::Dataspace_client client(ds);
+    Attachment *a = new (_alloc) Attachment(ds, _env.rm().attach(ds),
+                                            client.phys_addr(), client.size());
+    _attachments.insert(a);
+    return *a;
+}
+
+
+char *Soft_session::_local(Genode::addr_t phys, Genode::size_t size)
+{
+    Genode::Lock::Guard guard(_attachments_lock);
+    for(Attachment *a = _attachments.first(); a; a = a->next())
+    {
+        if(phys >= a->phys_addr && size <= a->size &&
+           phys - a->phys_addr <= a->size - size)
+            return a->local + (phys - a->phys_addr);
+    }
+    throw Cdma::Invalid_memcpy_address();
+}
+
+
+char *Soft_session::_local(Genode::Dataspace_capability ds, Genode::off_t offset,
+                           Genode::size_t size)
+{
+    Attachment &a = _attachment(ds);
+    if(offset < 0 || size > a.size || (Genode::size_t)offset > a.size - size)
+        throw Cdma::Invalid_memcpy_address();
+    return a.local + offset;
+}
+
+
+void Soft_session::_remove(Attachment &a)
+{
+    _attachments.remove(&a);
+    _env.rm().detach(a.local);
+    Genode::destroy(_alloc, &a);
+}
+
+
+void Soft_session::attach(Genode::Dataspace_capability ds)
+{
+    Attachment &a = _attachment(ds);
+
+    Genode::Lock::Guard guard(_attachments_lock);
+    a.refs++;
+}
+
+
+void Soft_session::detach(Genode::Dataspace_capability ds)
+{
+    Genode::Lock::Guard guard(_attachments_lock);
+    for(Attachment *a = _attachments.first(); a; a = a->next())
+    {
+        if(!(a->cap == ds))
+            continue;
+
+        if(a->refs && --a->refs)
+            return;
+
+        _remove(*a);
+        return;
+    }
+}
+
+
+void Soft_session::invalidate(Genode::Dataspace_capability ds)
+{
+    Genode::Lock::Guard guard(_attachments_lock);
+    for(Attachment *a = _attachments.first(); a; a = a->next())
+    {
+        if(a->cap == ds) {
+            _remove(*a);
+            return;
+        }
+    }
+}
+
+
+void Soft_session::memcpy(Genode::addr_t dst, Genode::addr_t src, Genode::size_t size)
+{
+    _transfer([&] () {
+        _progress.completed = 0;
+        Genode::memory_barrier();
+        _progress.transfer = _progress.transfer + 1;
+
+        _failed = Range { 0, size };
+        _engine.copy(_local(dst, size), _local(src, size), size);
+        _failed = Range { 0, 0 };
+
+        _progress.completed = size;
+    });
+}
+
+
+void Soft_session::memset(Genode::addr_t dst, Genode::uint8_t value, Genode::size_t size)
+{
+    _transfer([&] () {
+        _failed = Range { 0, size };
+        _engine.set(_local(dst, size), value, size);
+        _failed = Range { 0, 0 };
+    });
+}
+
+
+void Soft_session::copy(Genode::Dataspace_capability dst, Genode::off_t dst_offset,
+                        Genode::Dataspace_capability src, Genode::off_t src_offset,
+                        Genode::size_t size)
+{
+    _transfer([&] () {
+        _failed = Range { 0, size };
+        _engine.copy(_local(dst, dst_offset, size), _local(src, src_offset, size), size);
+        _failed = Range { 0, 0 };
+    });
+}
+
+
+void Soft_session::fanout(Destinations dst, Genode::addr_t src, Genode::size_t size)
+{
+    if(!dst.count || dst.count > Destinations::MAX)
+        throw Cdma::Invalid_memcpy_address();
+
+    _transfer([&] () {
+        _failed = Range { 0, size };
+        char const *s = _local(src, size);
+        for(unsigned i = 0; i < dst.count; i++)
+            _engine.copy(_local(dst.addr[i], size), s, size);
+        _failed = Range { 0, 0 };
+    });
+}
+
+
+template <typename FN>
+void Soft_session::_copies(unsigned count, FN const &copy_at)
+{
+    _transfer([&] () {
+        for(unsigned i = 0; i < count; i++)
+        {
+            // all copies from the failed one on are reported as failed
+            _failed = Range { i, count - i };
+            Copy const copy = copy_at(i);
+            _engine.copy(_local(copy.dst, copy.size), _local(copy.src, copy.size),
+                         copy.size);
+        }
+        _failed = Range { 0, 0 };
+    });
+}
+
+
+void Soft_session::stride(Stride stride)
+{
+    _copies(stride.rows, [&] (unsigned i) {
+        return Copy { stride.dst + i*stride.dst_pitch, stride.src + i*stride.src_pitch,
+                      stride.row_size }; });
+}
+
+
+void Soft_session::batch(unsigned count)
+{
+    if(count > Batch::MAX)
+        throw Cdma::Invalid_memcpy_address();
+
+    _copies(count, [&] (unsigned i) { return _batch.copy[i]; });
+}
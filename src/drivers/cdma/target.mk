@@ -4,8 +4,8 @@
 
 TARGET   = cdma_drv
 
-SRC_CC   = main.cc driver.cc
-LIBS     = base
+SRC_CC   = main.cc
+LIBS     = base cdma
 INC_DIR += $(PRG_DIR)
 
 vpath main.cc $(PRG_DIR)
@@ -0,0 +1,52 @@
+/*
+ * \brief  CDMA session shared by all intercepting pd sessions
+ * \author Johannes Fischer
+ * \date   2019-10-16
+ */
+
+#include <rtcr_cdma/backend.h>
+#include <rtcr_cdma/pd_session.h>
+
+using namespace Rtcr;
+
+
+Cdma_backend::Cdma_backend(Genode::Env &env, Genode::Allocator &alloc)
+	:
+	_session(_open(env, alloc)),
+	_limits(_session.limits()),
+	_batch(env.rm(), _session.batch_dataspace())
+{ }
+
+
+Cdma_backend &Cdma_backend::factory(Genode::Env &env, Genode::Allocator &alloc)
+{
+	static Cdma_backend backend(env, alloc);
+	return backend;
+}
+
+
+Cdma::Session &Cdma_backend::_open(Genode::Env &env, Genode::Allocator &alloc)
+{
+	Pd_cdma_session::Config const &config = Pd_cdma_session::config();
+
+	if(config.driver && config.driver->is_supported()) {
+		_local.construct(env, alloc, *config.driver);
+		return *_local;
+	}
+
+	if(!config.driver && !config.software) {
+		try {
+			_connection.construct(env);
+			if(_connection->is_supported())
+				return *_connection;
+			_connection.destruct();
+		} catch (Genode::Service_denied) { }
+	}
+
+	if(!config.software)
+		Genode::warning("CDMA is not available, copy by the software engine.");
+
+	_soft.construct(env, alloc,
+			Cdma::Soft_engine::factory(env, alloc, config.software_threads));
+	return *_soft;
+}
@@ -4,6 +4,7 @@
  * \date   2019-08-29
  */
 #include <rtcr_cdma/cdma_module.h>
+#include <util/misc_math.h>
 
 #ifdef PROFILE
 #include <util/profiler.h>
@@ -35,7 +36,135 @@ Cdma_module::Cdma_module(Genode::Env &env, Genode::Allocator &alloc)
 	_log(env, alloc, _ep, _childs_lock, _childs, _services),
 	_timer(env, alloc, _ep, _childs_lock, _childs, _services),
 	_rom(env, alloc, _ep, _childs_lock, _childs, _services),
-	_rm(env, alloc, _ep, _childs_lock, _childs, _services)	
+	_rm(env, alloc, _ep, _childs_lock, _childs, _services),
+	_copy_queue(Cdma_copy_queue::factory(env)),
+	_dst_arena(Cdma_dst_arena::factory(env, alloc)),
+	_trace(Cdma_trace::factory(env, alloc)),
+	_timing(Cdma_timing::factory(env)),
+	_config(env, "config")
 {
 	DEBUG_THIS_CALL;
+
+	_config.xml().for_each_sub_node("module", [&] (Genode::Xml_node module) {
+		if(module.attribute_value("name", Module_name()) == name())
+			_configure(env, module);
+	});
+
+	/* the pd sessions share the CDMA session, which is opened once */
+	_timing.calibrate(Cdma_backend::factory(env, alloc).limits());
+}
+
+
+void Cdma_module::_configure(Genode::Env &env, Genode::Xml_node module)
+{
+	DEBUG_THIS_CALL;
+	try {
+		/* drive the CDMA without `cdma_drv`, which must not run then */
+		Pd_cdma_session::config().driver =
+			&Cdma::Driver::factory(env, module.sub_node("driver"));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node software = module.sub_node("software");
+		Pd_cdma_session::config().software = true;
+		Pd_cdma_session::config().software_threads =
+			software.attribute_value("threads", 0U);
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node arena = module.sub_node("arena");
+		_dst_arena.configure(arena);
+		Pd_cdma_session::config().scrub = arena.attribute_value("scrub", false);
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node history = module.sub_node("history");
+		Pd_cdma_session::config().history_depth =
+			history.attribute_value("depth", 1U);
+		Pd_cdma_session::config().history_budget =
+			history.attribute_value("budget", Genode::Number_of_bytes(0));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node hybrid = module.sub_node("hybrid");
+		Pd_cdma_session::config().hybrid_min =
+			hybrid.attribute_value("min", Genode::Number_of_bytes(16*1024*1024));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node prefault = module.sub_node("prefault");
+		Pd_cdma_session::config().prefault = true;
+		Pd_cdma_session::config().prefault_hot =
+			prefault.attribute_value("hot", false);
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		module.sub_node("replica");
+		Pd_cdma_session::config().replica = true;
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node sparse = module.sub_node("sparse");
+		Pd_cdma_session::config().sparse_min =
+			sparse.attribute_value("min", Genode::Number_of_bytes(64*1024));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		_timing.configure(module.sub_node("deadline"));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		_trace.configure(module.sub_node("trace"));
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+
+	try {
+		Genode::Xml_node restore = module.sub_node("restore");
+		if(restore.attribute_value("lazy", false)) {
+			Genode::size_t window =
+				restore.attribute_value("window", Genode::Number_of_bytes(64*1024));
+			Pd_cdma_session::config().restore_window =
+				Genode::align_addr(window, 12);
+		}
+	}
+	catch (Genode::Xml_node::Nonexistent_sub_node) {}
+}
+
+
+void Cdma_module::checkpoint()
+{
+	/* the interface of `Init_module` returns nothing and its callers do
+	 * not expect an exception. A rejection is only logged by
+	 * `checkpoint(deadline_us)`, which reports it to callers of the
+	 * admission. */
+	checkpoint(_timing.deadline_us());
+}
+
+
+bool Cdma_module::checkpoint(Genode::uint64_t deadline_us)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	if(deadline_us) {
+		Genode::uint64_t const predicted_us = Pd_cdma_session::predict_all();
+		if(predicted_us > deadline_us) {
+			Genode::warning("checkpoint rejected, predicted ", predicted_us,
+					" us exceed the deadline of ", deadline_us, " us");
+			return false;
+		}
+	}
+
+	_trace.checkpoint_begin();
+	Init_module::checkpoint();
+	_copy_queue.join();
+	_trace.checkpoint_end();
+	return true;
 }
@@ -0,0 +1,22 @@
+/*
+ * \brief  Asynchronous issuing of CDMA transfers
+ * \author Johannes Fischer
+ * \date   2019-09-10
+ */
+
+#include <rtcr_cdma/copy_queue.h>
+
+using namespace Rtcr;
+
+
+Cdma_copy_queue::Cdma_copy_queue(Genode::Env &env)
+	:
+	Cdma::Job_queue(env, "cdma copy queue")
+{ }
+
+
+Cdma_copy_queue &Cdma_copy_queue::factory(Genode::Env &env)
+{
+	static Cdma_copy_queue queue(env);
+	return queue;
+}
@@ -0,0 +1,66 @@
+/*
+ * \brief  CPU part of a hybrid CPU and CDMA copy
+ * \author Johannes Fischer
+ * \date   2019-10-01
+ */
+
+#include <rtcr_cdma/cpu_copier.h>
+#include <cdma/soft_engine.h>
+
+using namespace Rtcr;
+
+
+static Genode::Affinity::Location _last_cpu(Genode::Env &env)
+{
+	Genode::Affinity::Space space = env.cpu().affinity_space();
+	if(space.width() < 2)
+		return Genode::Affinity::Location();
+	return Genode::Affinity::Location(space.width() - 1, 0);
+}
+
+
+Cdma_cpu_copier::Cdma_cpu_copier(Genode::Env &env)
+	:
+	Genode::Thread(env, "cdma cpu copier", STACK_SIZE, _last_cpu(env),
+		       Genode::Thread::Weight(), env.cpu())
+{
+	start();
+}
+
+
+Cdma_cpu_copier &Cdma_cpu_copier::factory(Genode::Env &env)
+{
+	static Cdma_cpu_copier copier(env);
+	return copier;
+}
+
+
+void Cdma_cpu_copier::copy(void *dst, void const *src, Genode::size_t size)
+{
+	Cdma::Soft_engine::copy_kernel(dst, src, size);
+}
+
+
+void Cdma_cpu_copier::start(void *dst, void const *src, Genode::size_t size)
+{
+	_dst  = dst;
+	_src  = src;
+	_size = size;
+	_started.up();
+}
+
+
+void Cdma_cpu_copier::wait()
+{
+	_finished.down();
+}
+
+
+void Cdma_cpu_copier::entry()
+{
+	while (true) {
+		_started.down();
+		copy(_dst, _src, _size);
+		_finished.up();
+	}
+}
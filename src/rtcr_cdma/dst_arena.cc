@@ -0,0 +1,156 @@
+/*
+ * \brief  Arena of destination dataspaces for checkpointed ram dataspaces
+ * \author Johannes Fischer
+ * \date   2019-09-12
+ */
+
+#include <rtcr_cdma/dst_arena.h>
+#include <dataspace/client.h>
+#include <util/misc_math.h>
+#include <util/string.h>
+#include <base/log.h>
+
+using namespace Rtcr;
+
+
+Cdma_dst_arena::Cdma_dst_arena(Genode::Env &env, Genode::Allocator &alloc)
+	:
+	_env(env), _alloc(alloc)
+{ }
+
+
+Cdma_dst_arena &Cdma_dst_arena::factory(Genode::Env &env, Genode::Allocator &alloc)
+{
+	static Cdma_dst_arena arena(env, alloc);
+	return arena;
+}
+
+
+Genode::size_t Cdma_dst_arena::_aligned(Genode::size_t size)
+{
+	return Genode::align_addr(size, PAGE_SIZE_LOG2);
+}
+
+
+Cdma_dst_arena::Buffer &Cdma_dst_arena::_alloc_buffer(Genode::size_t size,
+						      Genode::Cache_attribute cached)
+{
+	Genode::Ram_dataspace_capability cap = _env.pd().alloc(size, cached);
+
+	return *new (_alloc) Buffer(cap, size, cached,
+				    Genode::Dataspace_client(cap).phys_addr());
+}
+
+
+void Cdma_dst_arena::_free_buffer(Buffer &buffer)
+{
+	_env.pd().free(buffer.cap);
+	Genode::destroy(_alloc, &buffer);
+}
+
+
+void Cdma_dst_arena::_insert(Buffer &buffer, unsigned max_free)
+{
+	Genode::List<Buffer> &free = _free[buffer.cached];
+
+	unsigned same_size = 0;
+	Buffer *prev = nullptr;
+	for (Buffer *b = free.first(); b && b->size <= buffer.size; prev = b, b = b->next())
+		if (b->size == buffer.size)
+			same_size++;
+
+	if (same_size >= max_free) {
+		_free_buffer(buffer);
+		return;
+	}
+
+	free.insert(&buffer, prev);
+}
+
+
+void Cdma_dst_arena::_zero(Buffer &buffer)
+{
+	char *data = _env.rm().attach(buffer.cap);
+	Genode::memset(data, 0, buffer.size);
+	_env.rm().detach(data);
+	buffer.zeroed = true;
+}
+
+
+void Cdma_dst_arena::configure(Genode::Xml_node arena)
+{
+	_max_free = arena.attribute_value("max_free", _max_free);
+
+	arena.for_each_sub_node("reserve", [&] (Genode::Xml_node reserve) {
+		Genode::size_t size = reserve.attribute_value("size", Genode::Number_of_bytes(0));
+		unsigned count = reserve.attribute_value("count", 0U);
+		bool cached = reserve.attribute_value("cached", false);
+
+		if (size)
+			this->reserve(size, cached ? Genode::CACHED : Genode::UNCACHED, count);
+	});
+}
+
+
+void Cdma_dst_arena::reserve(Genode::size_t size, Genode::Cache_attribute cached,
+			     unsigned count)
+{
+	if (!size) {
+		Genode::error("arena: cannot reserve buffers of 0 bytes");
+		return;
+	}
+
+	Genode::Lock::Guard guard(_lock);
+	for (unsigned i = 0; i < count; i++)
+		_insert(_alloc_buffer(_aligned(size), cached), ~0U);
+}
+
+
+Cdma_dst_arena::Owner Cdma_dst_arena::new_owner()
+{
+	Genode::Lock::Guard guard(_lock);
+	return ++_last_owner;
+}
+
+
+Cdma_dst_arena::Buffer &Cdma_dst_arena::acquire(Genode::size_t size,
+						Genode::Cache_attribute cached,
+						Owner owner)
+{
+	if (!size)
+		throw Invalid_size();
+
+	Genode::size_t const aligned = _aligned(size);
+	Buffer *buffer = nullptr;
+	{
+		Genode::Lock::Guard guard(_lock);
+
+		/* the first large enough buffer fits best */
+		for (Buffer *b = _free[cached].first(); b; b = b->next()) {
+			if (b->size < aligned)
+				continue;
+			if (b->size - aligned <= aligned >> MAX_WASTE_SHIFT)
+				buffer = b;
+			break;
+		}
+
+		if (buffer)
+			_free[cached].remove(buffer);
+		else
+			buffer = &_alloc_buffer(aligned, cached);
+	}
+
+	/* never hand out the checkpoint of another child */
+	if (buffer->owner != owner && !buffer->zeroed)
+		_zero(*buffer);
+
+	buffer->owner = owner;
+	return *buffer;
+}
+
+
+void Cdma_dst_arena::release(Buffer &buffer)
+{
+	Genode::Lock::Guard guard(_lock);
+	_insert(buffer, _max_free);
+}
@@ -0,0 +1,51 @@
+/*
+ * \brief  Batched copy of the dataspaces of a forked child
+ * \author Johannes Fischer
+ * \date   2019-10-09
+ */
+
+#include <rtcr_cdma/fork.h>
+#include <rtcr_cdma/cpu_copier.h>
+#include <base/log.h>
+
+using namespace Rtcr;
+
+
+void Cdma_fork::add(Genode::Ram_dataspace_capability dst, Genode::addr_t dst_addr,
+		    Genode::Ram_dataspace_capability src, Genode::addr_t src_addr,
+		    Genode::size_t size)
+{
+	_entries[_count++] = Entry { dst, src, Cdma::Copy { dst_addr, src_addr, size } };
+}
+
+
+unsigned Cdma_fork::submit(Cdma::Session &cdma, Cdma::Batch &batch)
+{
+	for(unsigned i = 0; i < _count; i++)
+		batch.copy[i] = _entries[i].copy;
+
+	try {
+		cdma.batch(_count);
+	} catch (Cdma::Function_unsupported &) {
+		return 0;
+	} catch (Cdma::Exception &) {
+		unsigned const first_failed = cdma.failed_range().offset;
+		Genode::warning("CDMA batch failed, copy ", _count - first_failed,
+				" dataspaces by CPU.");
+		return first_failed;
+	}
+	return _count;
+}
+
+
+void Cdma_fork::complete(unsigned first_failed)
+{
+	for(unsigned i = first_failed; i < _count; i++) {
+		char *d = _rm.attach(_entries[i].dst);
+		char *s = _rm.attach(_entries[i].src);
+		Cdma_cpu_copier::copy(d, s, _entries[i].copy.size);
+		_rm.detach(s);
+		_rm.detach(d);
+	}
+	_count = 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * \brief  Checkpoint history of a ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-09-16
+ */
+
+#include <rtcr_cdma/history.h>
+#include <util/string.h>
+#include <util/construct_at.h>
+
+using namespace Rtcr;
+
+
+Cdma_history::~Cdma_history()
+{
+	while (_count)
+		_drop_oldest();
+	if (_modified)
+		_alloc.free(_modified, _pages*sizeof(Genode::size_t));
+}
+
+
+void Cdma_history::_drop_oldest()
+{
+	Generation *oldest = _generations.first();
+	while (oldest->next())
+		oldest = oldest->next();
+
+	_generations.remove(oldest);
+	Genode::size_t const bytes = Generation::bytes(oldest->count);
+	oldest->~Generation();
+	_alloc.free(oldest, bytes);
+	_bytes -= bytes;
+	_count--;
+}
+
+
+void Cdma_history::record(void const *image, void const *next, Genode::size_t size)
+{
+	if (_depth < 2)
+		return;
+
+	char const *old_page = (char const *)image;
+	char const *new_page = (char const *)next;
+	Genode::size_t const pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+	/* the size of a dataspace never changes */
+	if (!_modified) {
+		_pages = pages;
+		_modified = (Genode::size_t *)_alloc.alloc(_pages*sizeof(Genode::size_t));
+	}
+
+	Genode::size_t count = 0;
+	for (Genode::size_t i = 0; i < pages; i++) {
+		Genode::size_t len = Genode::min((Genode::size_t)PAGE_SIZE, size - i*PAGE_SIZE);
+
+		if (Genode::memcmp(old_page + i*PAGE_SIZE, new_page + i*PAGE_SIZE, len))
+			_modified[count++] = i;
+	}
+
+	/* older generations are only rewound through the new one, thus they
+	 * are dropped as well, if it exceeds the budget */
+	Genode::size_t const bytes = Generation::bytes(count);
+	if (bytes > _budget) {
+		while (_count)
+			_drop_oldest();
+		return;
+	}
+
+	while (_count && (_count + 1 >= _depth || _bytes + bytes > _budget))
+		_drop_oldest();
+
+	Generation *generation =
+		Genode::construct_at<Generation>(_alloc.alloc(bytes), count);
+	for (Genode::size_t j = 0; j < count; j++) {
+		Genode::size_t const i = _modified[j];
+		Genode::size_t len = Genode::min((Genode::size_t)PAGE_SIZE, size - i*PAGE_SIZE);
+
+		generation->index()[j] = i;
+		Genode::memcpy(generation->data() + j*PAGE_SIZE, old_page + i*PAGE_SIZE, len);
+	}
+
+	_generations.insert(generation);
+	_bytes += bytes;
+	_count++;
+}
+
+
+bool Cdma_history::rollback(void *image, unsigned generations)
+{
+	if (generations > _count)
+		return false;
+
+	for (unsigned i = 0; i < generations; i++) {
+		Generation *generation = _generations.first();
+
+		/* pages of the last partial page are copied completely, the
+		 * dataspace is always a multiple of the page size */
+		for (Genode::size_t j = 0; j < generation->count; j++)
+			Genode::memcpy((char *)image + generation->index()[j]*PAGE_SIZE,
+				       generation->data() + j*PAGE_SIZE, PAGE_SIZE);
+
+		_generations.remove(generation);
+		Genode::size_t const bytes = Generation::bytes(generation->count);
+		generation->~Generation();
+		_alloc.free(generation, bytes);
+		_bytes -= bytes;
+		_count--;
+	}
+	return true;
+}
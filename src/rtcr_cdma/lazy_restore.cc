@@ -0,0 +1,198 @@
+/*
+ * \brief  On-demand restore of a ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-09-19
+ */
+
+#include <rtcr_cdma/lazy_restore.h>
+#include <rtcr_cdma/cpu_copier.h>
+#include <dataspace/client.h>
+#include <util/string.h>
+
+using namespace Rtcr;
+
+
+Genode::Entrypoint &Cdma_lazy_restore::entrypoint(Genode::Env &env)
+{
+	static Genode::Entrypoint ep(env, 16*1024, "lazy restore ep",
+				     Genode::Affinity::Location());
+	return ep;
+}
+
+
+Genode::addr_t Cdma_lazy_restore::_checked_addr(Genode::Ram_dataspace_capability target,
+						Genode::size_t size)
+{
+	Genode::Dataspace_client ds(target);
+	Genode::addr_t const addr = ds.phys_addr();
+	if(!addr || ds.size() < size)
+		throw Unsupported_target();
+
+	return addr;
+}
+
+
+Cdma_lazy_restore::Cdma_lazy_restore(Genode::Env &env,
+				     Genode::Entrypoint &ep,
+				     Genode::Allocator &alloc,
+				     Cdma_backend &backend,
+				     Cdma_copy_queue &copy_queue,
+				     Genode::Ram_dataspace_capability checkpoint,
+				     Genode::addr_t checkpoint_addr,
+				     Genode::Ram_dataspace_capability target,
+				     Genode::size_t size,
+				     Genode::size_t window,
+				     Cdma_zero_map const *zero_map)
+	:
+	_local_rm(env.rm()),
+	_alloc(alloc),
+	_backend(backend),
+	_copy_queue(copy_queue),
+	_checkpoint(checkpoint),
+	_checkpoint_addr(checkpoint_addr),
+	_target(target),
+	_target_addr(_checked_addr(target, size)),
+	_size(size),
+	_window(window),
+	_windows((size + window - 1) / window),
+	_zero_map(zero_map),
+	_state((Genode::uint8_t *)alloc.alloc(_windows)),
+	_remaining(_windows),
+	_rm(env),
+	_map(_rm.create(size)),
+	_fault_handler(ep, *this, &Cdma_lazy_restore::_handle_fault)
+{
+	Genode::memset(_state, EMPTY, _windows);
+	_map.fault_handler(_fault_handler);
+
+	/* fill in everything the child does not touch in background */
+	_copy_queue.submit(_sweep_job);
+}
+
+
+Cdma_lazy_restore::~Cdma_lazy_restore()
+{
+	if(_sweep_job.pending())
+		_copy_queue.join();
+
+	if(_state)
+		_alloc.free(_state, _windows);
+}
+
+
+bool Cdma_lazy_restore::_claim(Genode::size_t window, bool wait)
+{
+	_lock.lock();
+	for(;;) {
+		if(!_state || _state[window] == PRESENT)
+			break;
+
+		if(_state[window] == EMPTY) {
+			_state[window] = FILLING;
+			_lock.unlock();
+			return true;
+		}
+
+		if(!wait)
+			break;
+
+		_waiters++;
+		_lock.unlock();
+		_filled.down();
+		_lock.lock();
+	}
+	_lock.unlock();
+	return false;
+}
+
+
+void Cdma_lazy_restore::_copy_by_cpu(Genode::off_t offset, Genode::size_t size, bool zero)
+{
+	char *dst = _local_rm.attach(_target, size, offset);
+	if(zero) {
+		Genode::memset(dst, 0, size);
+	} else {
+		char *src = _local_rm.attach(_checkpoint, size, offset);
+		Cdma_cpu_copier::copy(dst, src, size);
+		_local_rm.detach(src);
+	}
+	_local_rm.detach(dst);
+}
+
+
+void Cdma_lazy_restore::_fill(Genode::size_t window)
+{
+	Genode::off_t const offset = window*_window;
+	Genode::size_t const size = Genode::min(_window, _size - offset);
+
+	/* a zero window is written without reading the checkpoint */
+	bool const zero = _zero_map && _zero_map->zero(offset, size);
+	bool failed = false;
+	_backend.apply([&] (Cdma::Session &cdma, Cdma::Batch &) {
+		try {
+			if(zero)
+				cdma.memset(_target_addr + offset, 0, size);
+			else
+				cdma.memcpy(_target_addr + offset, _checkpoint_addr + offset, size);
+		} catch (Cdma::Exception &) {
+			failed = true;
+		}
+	});
+	if(failed) {
+		Genode::warning("lazy restore: CDMA transfer failed, copy window ",
+				window, " by CPU.");
+		_copy_by_cpu(offset, size, zero);
+	}
+
+	/* attaching the window resolves the pending faults inside of it */
+	_map.attach_at(_target, offset, size, offset);
+
+	Genode::Lock::Guard guard(_lock);
+	_state[window] = PRESENT;
+	for(; _waiters; _waiters--)
+		_filled.up();
+
+	/* every window is attached, thus no fault needs the windows anymore */
+	if(--_remaining)
+		return;
+
+	_alloc.free(_state, _windows);
+	_state = nullptr;
+}
+
+
+void Cdma_lazy_restore::_handle_fault()
+{
+	for(;;) {
+		Genode::Region_map::State state = _map.state();
+		if(state.type == Genode::Region_map::State::READY)
+			return;
+
+		if(state.addr >= _size) {
+			Genode::error("lazy restore: fault outside of dataspace at ",
+				      Genode::Hex(state.addr));
+			return;
+		}
+
+		/* a window, which is filled by the sweep, is waited for */
+		Genode::size_t const window = state.addr / _window;
+		if(_claim(window, true))
+			_fill(window);
+	}
+}
+
+
+void Cdma_lazy_restore::_sweep()
+{
+	/* windows, which are filled by a fault, are skipped */
+	for(Genode::size_t window = 0; window < _windows; window++)
+		if(_claim(window, false))
+			_fill(window);
+}
+
+
+bool Cdma_lazy_restore::complete()
+{
+	Genode::Lock::Guard guard(_lock);
+	return _remaining == 0;
+}
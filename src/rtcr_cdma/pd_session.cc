@@ -28,22 +28,97 @@ Pd_cdma_session::Pd_cdma_session(Genode::Env &env,
 				 Child_info *child_info)
 	:
 	Pd_session(env, md_alloc, ep, creation_args, child_info),
-	_cdma_drv(env)
+	_backend(Cdma_backend::factory(env, md_alloc)),
+	_copy_queue(Cdma_copy_queue::factory(env)),
+	_dst_arena(Cdma_dst_arena::factory(env, md_alloc)),
+	_arena_owner(_dst_arena.new_owner()),
+	_cpu_copier(Cdma_cpu_copier::factory(env)),
+	_trace(Cdma_trace::factory(env, md_alloc)),
+	_timing(Cdma_timing::factory(env)),
+	_limits(_backend.limits())
 {
 	DEBUG_THIS_CALL;
+	Genode::Lock::Guard guard(_sessions_lock());
+	_sessions().insert(&_session_elem);
+}
+
+
+Pd_cdma_session::~Pd_cdma_session()
+{
+	{
+		Genode::Lock::Guard guard(_sessions_lock());
+		_sessions().remove(&_session_elem);
+	}
 
-	if (!_cdma_drv.is_supported()) {
-		Genode::error("Cdma driver is not supported. No fallback supported.");
-	}	
+	while(Cdma_lazy_restore *restore = _lazy_restores.first()) {
+		_lazy_restores.remove(restore);
+		Genode::destroy(_md_alloc, restore);
+	}
+	_copy_queue.join();
+
+	while(Unattached *e = _unattached.first()) {
+		_unattached.remove(e);
+		Genode::destroy(_md_alloc, e);
+	}
 }
 
 
 void Pd_cdma_session::_destroy_dataspace(Ram_dataspace *ds)
 {
 	DEBUG_THIS_CALL;
-	if(!ds->i_cached) {
-		Genode::destroy(_md_alloc, (Physical_address *)ds->storage);
-	}
+	/* a dataspace which was never checkpointed has no destination */
+	Copy_job *job = (Copy_job *)ds->storage;
+	if(job) {
+		/* never recycle a destination which is still written by the CDMA */
+		if(job->pending())
+			_copy_queue.join();
+
+		/* the managed dataspace of a lazy restore reads the destination */
+		_destroy_restore(*job);
+
+		/* the destination belongs to the arena, hide it from the base
+		 * implementation which would free it. */
+		ds->i_dst_cap = Genode::Ram_dataspace_capability();
+		if(!ds->i_cached) {
+			/* the copies address physically, thus the driver holds no
+			 * capability of the dataspaces, which has to be invalidated */
+			if(config().scrub)
+				_backend.apply([&] (Cdma::Session &cdma, Cdma::Batch &) {
+					try {
+						cdma.memset(job->dst_addr, 0, job->dst.size);
+						job->dst.zeroed = true;
+						if(job->replica) {
+							cdma.memset(job->replica->phys_addr, 0,
+								    job->replica->size);
+							job->replica->zeroed = true;
+						}
+					} catch (Cdma::Exception &) {
+						Genode::warning("Scrubbing of destination by CDMA failed.");
+					}
+				});
+			_backend.detach(ds->i_src_cap);
+			_backend.detach(job->dst.cap);
+			if(job->replica)
+				_backend.detach(job->replica->cap);
+		}
+		_dst_arena.release(job->dst);
+		if(job->replica)
+			_dst_arena.release(*job->replica);
+
+		{
+			Genode::Lock::Guard guard(_jobs_lock);
+			_jobs.remove(&job->elem);
+		}
+		if(job->history)
+			Genode::destroy(_md_alloc, job->history);
+		if(job->working_set)
+			Genode::destroy(_md_alloc, job->working_set);
+		if(job->zero_map)
+			Genode::destroy(_md_alloc, job->zero_map);
+		Genode::destroy(_md_alloc, job);
+		ds->storage = nullptr;
+	} else
+		_remove_unattached(ds);
 	Pd_session::_destroy_dataspace(ds);
 }
 
@@ -51,26 +126,85 @@ void Pd_cdma_session::_destroy_dataspace(Ram_dataspace *ds)
 void Pd_cdma_session::_alloc_dataspace(Ram_dataspace *ds)
 {
 	DEBUG_THIS_CALL;
-	/* only if the src dataspace is allocated as uncached, also the
-	 * destination dataspace will be allocated as uncached */
-	ds->i_dst_cap = _env.pd().alloc(ds->i_size, ds->i_cached);
+	/* The destination is handed out lazily by the arena, when the dataspace
+	 * is checkpointed for the first time. Children which never get
+	 * checkpointed, do not pay for it. Until then the dataspace is only
+	 * listed for the prediction of the next checkpoint. */
+	Unattached *e = new (_md_alloc) Unattached(ds);
+	Genode::Lock::Guard guard(_jobs_lock);
+	_unattached.insert(e);
+}
+
+
+void Pd_cdma_session::_remove_unattached(Ram_dataspace *ds)
+{
+	Unattached *e = nullptr;
+	{
+		Genode::Lock::Guard guard(_jobs_lock);
+		for(e = _unattached.first(); e && e->object() != ds; e = e->next());
+		if(e)
+			_unattached.remove(e);
+	}
+	if(e)
+		Genode::destroy(_md_alloc, e);
 }
 
 
 void Pd_cdma_session::_attach_dataspace(Ram_dataspace *ds)
 {
 	DEBUG_THIS_CALL;
-	Pd_session::_attach_dataspace(ds);
+	if(!ds->storage) {
+		/* only if the src dataspace is allocated as uncached, also the
+		 * destination dataspace will be allocated as uncached */
+		Cdma_dst_arena::Buffer &dst = _dst_arena.acquire(ds->i_size, ds->i_cached, _arena_owner);
+		ds->i_dst_cap = dst.cap;
+
+		/* the physical address of the source is resolved once, such that
+		 * a copy costs no RPC to core. A source without one is copied by
+		 * the CPU. */
+		bool const sparse = !ds->i_cached && config().sparse_min &&
+				    ds->i_size >= config().sparse_min && !config().replica;
+		Genode::addr_t src_addr = 0;
+		if(!ds->i_cached)
+			src_addr = Genode::Dataspace_client(ds->i_src_cap).phys_addr();
+
+		Copy_job *job = new (_md_alloc) Copy_job(*this, ds, dst, src_addr);
+		if(config().history_depth > 1)
+			job->history = new (_md_alloc) Cdma_history(_md_alloc,
+								    config().history_depth,
+								    config().history_budget ?
+								    config().history_budget :
+								    ds->i_size);
+		if(config().replica && !ds->i_cached) {
+			job->replica = &_dst_arena.acquire(ds->i_size, ds->i_cached, _arena_owner);
+			job->replica->zeroed = false;
+		}
+		if(config().prefault && config().prefault_hot)
+			job->working_set = new (_md_alloc) Cdma_working_set(_md_alloc,
+									    ds->i_size);
+		if(sparse && src_addr)
+			job->zero_map = new (_md_alloc) Cdma_zero_map(_md_alloc, ds->i_size,
+								      dst.zeroed);
+		dst.zeroed = false;
+		ds->storage = job;
 
-	if(!ds->i_cached) {
-		/* also directly calculate the physical address. I assume that it will
-		 * not change again. */
-		Genode::Dataspace_client dst_client(ds->i_dst_cap);
-		Genode::Dataspace_client src_client(ds->i_src_cap);
+		/* the copies, the fan-out to the replica and scrubbing address
+		 * physically */
+		if(!ds->i_cached) {
+			_backend.attach(ds->i_src_cap);
+			_backend.attach(dst.cap);
+			if(job->replica)
+				_backend.attach(job->replica->cap);
+		}
 
-		ds->storage = new (_md_alloc) Physical_address(dst_client.phys_addr(),
-							       src_client.phys_addr());
+		{
+			Genode::Lock::Guard guard(_jobs_lock);
+			_jobs.insert(&job->elem);
+		}
+		_remove_unattached(ds);
 	}
+
+	Pd_session::_attach_dataspace(ds);
 }
 
 
@@ -78,13 +212,503 @@ void Pd_cdma_session::_copy_dataspace(Ram_dataspace *ds)
 {
 	DEBUG_THIS_CALL PROFILE_THIS_CALL;
 	/* only copy a dataspace with hardware-acceleration, if it is supported
-	 * by the dataspace (uncached) */
-	if(!ds->i_cached) {
-		Physical_address *p = (Physical_address *)ds->storage;		
-		_cdma_drv.memcpy(p->dst_addr, p->src_addr, ds->i_size);	
+	 * by the dataspace (uncached) and the CDMA is faster than the CPU for
+	 * its size */
+	Copy_job *job = (Copy_job *)ds->storage;
+	if(!ds->i_cached && ds->i_size >= _limits.crossover && job->src_addr) {
+		/* the transfer is only issued here. The copy queue is joined by
+		 * `Cdma_module::checkpoint` before the checkpoint completes. */
+		if(job->pending())
+			_copy_queue.join();
+
+		/* the comparison with the image has to finish before the CDMA
+		 * overwrites it. It runs in this thread, while the copy queue
+		 * transfers the previously submitted dataspaces. */
+		_record_history(*job);
+		_copy_queue.submit(*job);
 	} else {
+		_record_history(*job);
+
+		Genode::uint64_t const start = _trace.now();
+		Genode::uint64_t const begin = _timing.now();
 		Pd_session::_copy_dataspace(ds);
+		_trace.record(start, ds->i_size, Cdma_trace::CPU, _trace_flags(*job));
+		_timing.observe(Cdma_timing::CPU, ds->i_size, begin);
+	}
+
+}
+
+
+Genode::size_t Pd_cdma_session::_cpu_part(Genode::size_t size)
+{
+	Genode::size_t const dma = _limits.dma_throughput;
+	Genode::size_t const cpu = _limits.cpu_throughput;
+	if(!config().hybrid_min || size < config().hybrid_min || !dma || !cpu)
+		return 0;
+
+	/* both parts take the same time, if they are proportional to the
+	 * throughputs. The CDMA keeps whole pages. */
+	Genode::uint64_t const part = (Genode::uint64_t)size * cpu / (cpu + dma);
+	return (Genode::size_t)part & ~0xfffUL;
+}
+
+
+void Pd_cdma_session::_dma_copy(Copy_job &job)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	if(job.zero_map) {
+		if(job.zero_map->scan_due()) {
+			_sparse_copy(job);
+			return;
+		}
+		job.zero_map->copied_without_scan();
+	}
+
+	Genode::size_t const size = job.ds->i_size;
+	Genode::size_t const cpu_part = job.replica ? 0 : _cpu_part(size);
+	Genode::size_t const dma_part = size - cpu_part;
+	Genode::uint64_t const start = _trace.now();
+
+	/* the mappings are needed by the CPU part and by the fallback */
+	char *dst = nullptr;
+	char *src = nullptr;
+	if(cpu_part) {
+		dst = _env.rm().attach(job.dst.cap);
+		src = _env.rm().attach(job.ds->i_src_cap);
+		_cpu_copier.start(dst + dma_part, src + dma_part, cpu_part);
+	}
+
+	/* the shared session is released between the chunks, such that no
+	 * transfer exceeds the pause window */
+	Cdma_timing::Mode const mode = job.replica ? Cdma_timing::REPLICA
+				     : cpu_part    ? Cdma_timing::HYBRID
+				                   : Cdma_timing::CDMA;
+	Cdma_timing::Mode const chunk_mode = cpu_part ? Cdma_timing::CDMA : mode;
+	Genode::size_t const chunk = _timing.chunk(chunk_mode, dma_part);
+
+	/* only the transfers are timed, not the waits for the shared session
+	 * between them */
+	Genode::uint64_t transfer_us = 0;
+
+	bool unsupported = false;
+	Cdma::Range failed { 0, 0 };
+	for(Genode::size_t offset = 0; offset < dma_part && !failed.size; offset += chunk) {
+		Genode::size_t const part = Genode::min(chunk, dma_part - offset);
+		_backend.apply([&] (Cdma::Session &cdma, Cdma::Batch &) {
+			Genode::uint64_t const begin = _timing.now();
+			try {
+				if(job.replica) {
+					/* image and replica are written by a single chain */
+					Cdma::Destinations dsts { { job.dst_addr + offset,
+								    job.replica->phys_addr + offset }, 2 };
+					cdma.fanout(dsts, job.src_addr + offset, part);
+				} else {
+					cdma.memcpy(job.dst_addr + offset, job.src_addr + offset, part);
+				}
+			} catch (Cdma::Function_unsupported &) {
+				unsupported = !offset;
+				failed = Cdma::Range { offset, dma_part - offset };
+			} catch (Cdma::Exception &) {
+				/* the driver already resubmitted the failed descriptors, only
+				 * copy the remaining range and the remaining chunks by CPU */
+				Cdma::Range const range = cdma.failed_range();
+				Genode::size_t const end = offset + part == dma_part
+				                         ? offset + range.offset + range.size : dma_part;
+				failed = Cdma::Range { offset + range.offset,
+						       end - offset - range.offset };
+				Genode::warning("CDMA transfer failed, copy ", Genode::Hex(failed.size),
+						" bytes at offset ", Genode::Hex(failed.offset), " by CPU.");
+			}
+			transfer_us += _timing.now() - begin;
+
+			/* a fallback does not tell the time of the mode */
+			if(!failed.size)
+				_timing.observe(chunk_mode, part, begin);
+		});
+	}
+
+	if(cpu_part) {
+		Genode::uint64_t const begin = _timing.now();
+		_cpu_copier.wait();
+		transfer_us += _timing.now() - begin;
+	}
+
+	if(unsupported && !cpu_part) {
+		Pd_session::_copy_dataspace(job.ds);
+	} else if(failed.size) {
+		if(!cpu_part) {
+			dst = _env.rm().attach(job.dst.cap);
+			src = _env.rm().attach(job.ds->i_src_cap);
+		}
+		Cdma_cpu_copier::copy(dst + failed.offset, src + failed.offset, failed.size);
+		if(job.replica) {
+			char *replica = _env.rm().attach(job.replica->cap);
+			Cdma_cpu_copier::copy(replica + failed.offset, src + failed.offset,
+					      failed.size);
+			_env.rm().detach(replica);
+		}
+		if(!cpu_part) {
+			_env.rm().detach(src);
+			_env.rm().detach(dst);
+		}
+	}
+
+	if(cpu_part) {
+		_env.rm().detach(src);
+		_env.rm().detach(dst);
+	}
+
+	Cdma_trace::Engine const engine = job.replica ? Cdma_trace::REPLICA
+				        : cpu_part    ? Cdma_trace::HYBRID
+				                      : Cdma_trace::CDMA;
+	unsigned flags = _trace_flags(job);
+	if(unsupported || failed.size)
+		flags |= Cdma_trace::FALLBACK;
+	_trace.record(start, size, engine, flags);
+
+	/* the chunks of a hybrid copy are timed as CDMA copies, the whole copy
+	 * by its transfers and the remainder of the CPU part */
+	if(cpu_part && !(flags & Cdma_trace::FALLBACK))
+		_timing.observe_us(mode, size, transfer_us);
+}
+
+
+unsigned Pd_cdma_session::_trace_flags(Copy_job const &job) const
+{
+	return (job.ds->i_cached ? Cdma_trace::CACHED     : 0)
+	     | (job.src_addr     ? Cdma_trace::CONTIGUOUS : 0);
+}
+
+
+
+void Pd_cdma_session::_sparse_copy(Copy_job &job)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	Genode::uint64_t const start = _trace.now();
+	Cdma_zero_map &zero_map = *job.zero_map;
+
+	/* the scan and the transfers are timed, not the wait for the shared
+	 * session */
+	Genode::uint64_t begin = _timing.now();
+	char *src = _env.rm().attach(job.ds->i_src_cap);
+	zero_map.scan(src);
+	Genode::uint64_t copy_us = _timing.now() - begin;
+
+	/* the destination is only mapped for the fallback */
+	char *dst = nullptr;
+	auto cpu_dst = [&] () {
+		if(!dst)
+			dst = _env.rm().attach(job.dst.cap);
+		return dst;
+	};
+
+	bool fallback = false;
+	Genode::size_t copied = 0;
+	_backend.apply([&] (Cdma::Session &cdma, Cdma::Batch &batch) {
+		begin = _timing.now();
+		unsigned count = 0;
+		auto flush = [&] () {
+			unsigned first_failed = count;
+			try {
+				if(count)
+					cdma.batch(count);
+			} catch (Cdma::Function_unsupported &) {
+				first_failed = 0;
+			} catch (Cdma::Exception &) {
+				first_failed = cdma.failed_range().offset;
+			}
+			for(unsigned i = first_failed; i < count; i++) {
+				Genode::size_t const offset = batch.copy[i].src - job.src_addr;
+				Cdma_cpu_copier::copy(cpu_dst() + offset, src + offset,
+						      batch.copy[i].size);
+				fallback = true;
+			}
+			count = 0;
+		};
+
+		zero_map.for_each_copy([&] (Genode::size_t offset, Genode::size_t size) {
+			copied += size;
+			batch.copy[count++] = Cdma::Copy { job.dst_addr + offset,
+							   job.src_addr + offset, size };
+			if(count == Cdma::Batch::MAX)
+				flush();
+		});
+		flush();
+
+		/* zeros are only written, where the image holds other content */
+		zero_map.for_each_clear([&] (Genode::size_t offset, Genode::size_t size) {
+			try {
+				cdma.memset(job.dst_addr + offset, 0, size);
+			} catch (Cdma::Exception &) {
+				Genode::memset(cpu_dst() + offset, 0, size);
+				fallback = true;
+			}
+		});
+		copy_us += _timing.now() - begin;
+	});
+	zero_map.commit();
+
+	if(dst)
+		_env.rm().detach(dst);
+	_env.rm().detach(src);
+
+	_trace.record(start, copied, Cdma_trace::SPARSE,
+		      _trace_flags(job) | (fallback ? Cdma_trace::FALLBACK : 0));
+	if(!fallback)
+		_timing.observe_us(Cdma_timing::SPARSE, job.ds->i_size, copy_us);
+}
+
+
+Cdma_timing::Mode Pd_cdma_session::_mode(Copy_job const &job)
+{
+	if(job.ds->i_cached || job.ds->i_size < _limits.crossover || !job.src_addr)
+		return Cdma_timing::CPU;
+	if(job.zero_map && job.zero_map->scan_due())
+		return Cdma_timing::SPARSE;
+	if(job.replica)
+		return Cdma_timing::REPLICA;
+	if(_cpu_part(job.ds->i_size))
+		return Cdma_timing::HYBRID;
+	return Cdma_timing::CDMA;
+}
+
+
+Cdma_timing::Mode Pd_cdma_session::_mode(Ram_dataspace const &ds)
+{
+	/* like `_attach_dataspace` will set up the job. The physical address
+	 * is only resolved then, thus it is assumed to exist. The first copy
+	 * of a sparse dataspace scans. */
+	if(ds.i_cached || ds.i_size < _limits.crossover)
+		return Cdma_timing::CPU;
+	if(config().replica)
+		return Cdma_timing::REPLICA;
+	if(config().sparse_min && ds.i_size >= config().sparse_min)
+		return Cdma_timing::SPARSE;
+	if(_cpu_part(ds.i_size))
+		return Cdma_timing::HYBRID;
+	return Cdma_timing::CDMA;
+}
+
+
+Genode::uint64_t Pd_cdma_session::predict_checkpoint()
+{
+	Genode::uint64_t us = 0;
+	Genode::Lock::Guard guard(_jobs_lock);
+	for(Genode::List_element<Copy_job> *e = _jobs.first(); e; e = e->next()) {
+		Copy_job const &job = *e->object();
+		us += _timing.predict(_mode(job), job.ds->i_size);
 	}
+	for(Unattached *e = _unattached.first(); e; e = e->next())
+		us += _timing.predict(_mode(*e->object()), e->object()->i_size);
+	return us;
+}
+
+
+Genode::uint64_t Pd_cdma_session::predict_all()
+{
+	Genode::uint64_t us = 0;
+	Genode::Lock::Guard guard(_sessions_lock());
+	for(Genode::List_element<Pd_cdma_session> *e = _sessions().first(); e; e = e->next())
+		us += e->object()->predict_checkpoint();
+	return us;
+}
 
+
+void Pd_cdma_session::_record_history(Copy_job &job)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	/* the first checkpoint has no predecessor. The history only exists
+	 * with a depth of more than one checkpoint, the working set only with
+	 * `<prefault hot="true"/>`. Otherwise nothing is read by the CPU. */
+	bool const checkpointed = job.checkpointed;
+	job.checkpointed = true;
+	if((!job.history && !job.working_set) || !checkpointed)
+		return;
+
+	/* the child is paused, thus its dataspace already contains the
+	 * content of the upcoming checkpoint */
+	void *image = _env.rm().attach(job.dst.cap);
+	void *next  = _env.rm().attach(job.ds->i_src_cap);
+	if(job.working_set)
+		job.working_set->update(image, next, job.ds->i_size);
+	if(job.history)
+		job.history->record(image, next, job.ds->i_size);
+	_env.rm().detach(next);
+	_env.rm().detach(image);
 }
 
+
+bool Pd_cdma_session::rollback(unsigned generations)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	_copy_queue.join();
+
+	Genode::Lock::Guard guard(_jobs_lock);
+
+	/* the dataspaces of a child are only consistent with each other, if
+	 * either all or none of them are rewound */
+	for(Genode::List_element<Copy_job> *e = _jobs.first(); e; e = e->next()) {
+		Copy_job const *job = e->object();
+		if(!job->history || job->history->count() < generations)
+			return false;
+	}
+
+	for(Genode::List_element<Copy_job> *e = _jobs.first(); e; e = e->next()) {
+		Copy_job *job = e->object();
+		void *image = _env.rm().attach(job->dst.cap);
+		job->history->rollback(image, generations);
+		_env.rm().detach(image);
+		if(job->zero_map)
+			job->zero_map->invalidate();
+	}
+	return true;
+}
+
+
+Genode::Dataspace_capability
+Pd_cdma_session::restore_lazily(Ram_dataspace *ds,
+				Genode::Ram_dataspace_capability target)
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	Copy_job *job = (Copy_job *)ds->storage;
+	if(!config().restore_window || !job || ds->i_cached)
+		return Genode::Dataspace_capability();
+
+	/* the checkpoint has to be complete before it is restored */
+	if(job->pending())
+		_copy_queue.join();
+
+	/* a former restore of the dataspace is replaced by the new one */
+	_destroy_restore(*job);
+
+	_backend.attach(target);
+	try {
+		job->restore =
+			new (_md_alloc) Cdma_lazy_restore(_env, Cdma_lazy_restore::entrypoint(_env),
+							  _md_alloc, _backend, _copy_queue,
+							  job->dst.cap, job->dst_addr, target,
+							  ds->i_size, config().restore_window,
+							  job->zero_map);
+	} catch (Cdma_lazy_restore::Unsupported_target) {
+		_backend.detach(target);
+		Genode::warning("lazy restore: target is not physically contiguous, "
+				"restore eagerly");
+		return Genode::Dataspace_capability();
+	}
+	_lazy_restores.insert(job->restore);
+	return job->restore->dataspace();
+}
+
+
+void Pd_cdma_session::_destroy_restore(Copy_job &job)
+{
+	if(!job.restore)
+		return;
+
+	Genode::Ram_dataspace_capability const target = job.restore->target();
+	_lazy_restores.remove(job.restore);
+	Genode::destroy(_md_alloc, job.restore);
+	job.restore = nullptr;
+	_backend.detach(target);
+}
+
+
+void Pd_cdma_session::_cpu_copy(Genode::Ram_dataspace_capability dst,
+				Genode::Ram_dataspace_capability src,
+				Genode::size_t size)
+{
+	char *d = _env.rm().attach(dst);
+	char *s = _env.rm().attach(src);
+	Cdma_cpu_copier::copy(d, s, size);
+	_env.rm().detach(s);
+	_env.rm().detach(d);
+}
+
+
+void Pd_cdma_session::fork_dataspace(Ram_dataspace *target,
+				     Pd_cdma_session &origin,
+				     Ram_dataspace *source)
+{
+	DEBUG_THIS_CALL;
+	Copy_job *job = (Copy_job *)source->storage;
+	if(!job || !job->checkpointed) {
+		Genode::warning("fork of a dataspace which is not checkpointed");
+		return;
+	}
+
+	/* both sessions share the copy queue */
+	if(job->pending())
+		_copy_queue.join();
+
+	Genode::size_t const size = Genode::min(target->i_size, source->i_size);
+	if(target->i_cached || source->i_cached) {
+		_cpu_copy(target->i_src_cap, job->dst.cap, size);
+		return;
+	}
+
+	if(_fork.full())
+		fork_commit();
+
+	_backend.attach(target->i_src_cap);
+	_fork.add(target->i_src_cap, Genode::Dataspace_client(target->i_src_cap).phys_addr(),
+		  job->dst.cap, job->dst_addr, size);
+}
+
+
+void Pd_cdma_session::fork_commit()
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	if(_fork.empty())
+		return;
+
+	/* the copies which did not complete are copied after the shared
+	 * session is released */
+	unsigned first_failed = 0;
+	_backend.apply([&] (Cdma::Session &cdma, Cdma::Batch &batch) {
+		first_failed = _fork.submit(cdma, batch); });
+
+	/* the new child keeps its dataspaces, but the software engine does
+	 * not need to map them anymore */
+	_fork.for_each_target([&] (Genode::Ram_dataspace_capability target) {
+		_backend.detach(target); });
+	_fork.complete(first_failed);
+}
+
+
+Genode::Ram_dataspace_capability Pd_cdma_session::replica(Ram_dataspace *ds)
+{
+	Copy_job *job = (Copy_job *)ds->storage;
+	if(!job || !job->replica)
+		return Genode::Ram_dataspace_capability();
+
+	if(job->pending())
+		_copy_queue.join();
+	return job->replica->cap;
+}
+
+
+void Pd_cdma_session::prefault(Ram_dataspace *ds, Genode::addr_t virt,
+			       Genode::off_t offset, Genode::size_t size)
+{
+	DEBUG_THIS_CALL;
+	if(!config().prefault)
+		return;
+
+	Copy_job *job = (Copy_job *)ds->storage;
+	if(!job || !job->working_set) {
+		_prefault.add(virt, size);
+		return;
+	}
+
+	/* add runs of hot pages instead of single pages */
+	job->working_set->for_each_hot_run(offset, size,
+		[&] (Genode::size_t from, Genode::size_t run) {
+			_prefault.add(virt + from - offset, run); });
+}
+
+
+unsigned Pd_cdma_session::prefault_commit()
+{
+	DEBUG_THIS_CALL PROFILE_THIS_CALL;
+	return _prefault.apply(*this);
+}
@@ -0,0 +1,88 @@
+/*
+ * \brief  Batched eager mapping of restored dataspaces
+ * \author Johannes Fischer
+ * \date   2019-10-04
+ */
+
+#include <rtcr_cdma/prefault.h>
+#include <util/string.h>
+
+using namespace Rtcr;
+
+
+Cdma_working_set::Cdma_working_set(Genode::Allocator &alloc, Genode::size_t size)
+	:
+	_alloc(alloc),
+	_pages((size + PAGE_SIZE - 1) / PAGE_SIZE),
+	_hot((Genode::uint8_t *)alloc.alloc(_pages))
+{
+	/* before the second checkpoint, every page is considered hot */
+	Genode::memset(_hot, 1, _pages);
+}
+
+
+Cdma_working_set::~Cdma_working_set()
+{
+	_alloc.free(_hot, _pages);
+}
+
+
+void Cdma_working_set::update(void const *image, void const *next, Genode::size_t size)
+{
+	char const *old_page = (char const *)image;
+	char const *new_page = (char const *)next;
+
+	for (Genode::size_t i = 0; i < _pages; i++) {
+		Genode::size_t len = Genode::min((Genode::size_t)PAGE_SIZE, size - i*PAGE_SIZE);
+		_hot[i] = Genode::memcmp(old_page + i*PAGE_SIZE, new_page + i*PAGE_SIZE, len) != 0;
+	}
+}
+
+
+void Cdma_prefault::add(Genode::addr_t virt, Genode::size_t size)
+{
+	if (!size)
+		return;
+
+	Genode::addr_t start = virt;
+	Genode::addr_t end   = virt + size;
+
+	/* absorb all ranges which overlap or touch the new one */
+	Range *prev = nullptr;
+	for (Range *r = _ranges.first(); r; ) {
+		Range *next = r->next();
+		if (r->end < start) {
+			prev = r;
+		} else if (r->start <= end) {
+			start = Genode::min(start, r->start);
+			end   = Genode::max(end, r->end);
+			_ranges.remove(r);
+			Genode::destroy(_alloc, r);
+		} else {
+			break;
+		}
+		r = next;
+	}
+
+	_ranges.insert(new (_alloc) Range(start, end), prev);
+}
+
+
+unsigned Cdma_prefault::apply(Genode::Pd_session &pd)
+{
+	unsigned calls = 0;
+	for (Range *r = _ranges.first(); r; r = r->next(), calls++)
+		pd.map(r->start, r->end - r->start);
+
+	clear();
+	return calls;
+}
+
+
+void Cdma_prefault::clear()
+{
+	while (Range *r = _ranges.first()) {
+		_ranges.remove(r);
+		Genode::destroy(_alloc, r);
+	}
+}
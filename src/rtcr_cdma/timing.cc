@@ -0,0 +1,115 @@
+/*
+ * \brief  Timing model of the dataspace copies of checkpoints
+ * \author Johannes Fischer
+ * \date   2019-10-19
+ */
+
+#include <rtcr_cdma/timing.h>
+#include <util/misc_math.h>
+
+using namespace Rtcr;
+
+
+Cdma_timing::Cdma_timing(Genode::Env &env) : _env(env)
+{
+	for(unsigned mode = 0; mode < MODES; mode++)
+		_models[mode] = Model { _bytes_per_ms(DEFAULT_THROUGHPUT),
+					mode == CPU ? 0ULL : (Genode::uint64_t)DEFAULT_SETUP_NS };
+}
+
+
+Cdma_timing &Cdma_timing::factory(Genode::Env &env)
+{
+	static Cdma_timing timing(env);
+	return timing;
+}
+
+
+void Cdma_timing::configure(Genode::Xml_node deadline)
+{
+	Genode::Lock::Guard guard(_lock);
+	_deadline_us = deadline.attribute_value("us", 0UL);
+	_window_us = deadline.attribute_value("window_us", 0UL);
+	if(!_timer.constructed())
+		_timer.construct(_env);
+}
+
+
+void Cdma_timing::calibrate(Cdma::Limits const &limits)
+{
+	Genode::Lock::Guard guard(_lock);
+	if(limits.cpu_throughput)
+		_models[CPU].bytes_per_ms = _bytes_per_ms(limits.cpu_throughput);
+
+	if(!limits.dma_throughput)
+		return;
+
+	_models[CDMA].bytes_per_ms    = _bytes_per_ms(limits.dma_throughput);
+	_models[SPARSE].bytes_per_ms  = _models[CDMA].bytes_per_ms;
+	_models[HYBRID].bytes_per_ms  = _models[CDMA].bytes_per_ms + _models[CPU].bytes_per_ms;
+
+	/* the replica doubles the written bytes */
+	_models[REPLICA].bytes_per_ms = _models[CDMA].bytes_per_ms / 2;
+}
+
+
+Genode::size_t Cdma_timing::_chunk(Model const &model, Mode mode, Genode::size_t size) const
+{
+	if(!_window_us || mode == CPU || mode == SPARSE)
+		return size;
+
+	Genode::uint64_t const window_ns = _window_us*1000;
+	if(model.setup_ns >= window_ns)
+		return Genode::min(size, (Genode::size_t)PAGE_SIZE);
+
+	Genode::uint64_t const bytes = (window_ns - model.setup_ns)*model.bytes_per_ms/1000000;
+	return Genode::min(size, Genode::max((Genode::size_t)bytes & ~(Genode::size_t)(PAGE_SIZE - 1),
+					     (Genode::size_t)PAGE_SIZE));
+}
+
+
+void Cdma_timing::observe_us(Mode mode, Genode::size_t size, Genode::uint64_t us)
+{
+	if(!enabled() || !size)
+		return;
+
+	Genode::uint64_t const ns = us*1000;
+
+	Genode::Lock::Guard guard(_lock);
+	Model &model = _models[mode];
+	Genode::size_t const chunk = _chunk(model, mode, size);
+	Genode::uint64_t const chunks = (size + chunk - 1) / chunk;
+
+	if(size >= LARGE_COPY) {
+		/* the setup of large copies is negligible */
+		Genode::uint64_t const setup_ns = chunks*model.setup_ns;
+		if(ns > setup_ns)
+			model.bytes_per_ms = Genode::max(_ewma(model.bytes_per_ms,
+							       (Genode::uint64_t)size*1000000/(ns - setup_ns)),
+							 (Genode::uint64_t)1);
+	} else {
+		Genode::uint64_t const transfer_ns = (Genode::uint64_t)size*1000000/model.bytes_per_ms;
+		model.setup_ns = _ewma(model.setup_ns,
+				       ns > transfer_ns ? (ns - transfer_ns)/chunks : 0);
+	}
+}
+
+
+Genode::uint64_t Cdma_timing::predict(Mode mode, Genode::size_t size)
+{
+	if(!size)
+		return 0;
+
+	Genode::Lock::Guard guard(_lock);
+	Model const &model = _models[mode];
+	Genode::size_t const chunk = _chunk(model, mode, size);
+	Genode::uint64_t const chunks = (size + chunk - 1) / chunk;
+	return (chunks*model.setup_ns + (Genode::uint64_t)size*1000000/model.bytes_per_ms) / 1000;
+}
+
+
+Genode::size_t Cdma_timing::chunk(Mode mode, Genode::size_t size)
+{
+	Genode::Lock::Guard guard(_lock);
+	return _chunk(_models[mode], mode, size);
+}
@@ -0,0 +1,108 @@
+/*
+ * \brief  Trace of the dataspace copies of checkpoints
+ * \author Johannes Fischer
+ * \date   2019-10-17
+ */
+
+#include <rtcr_cdma/trace.h>
+#include <util/misc_math.h>
+
+using namespace Rtcr;
+
+
+Cdma_trace &Cdma_trace::factory(Genode::Env &env, Genode::Allocator &alloc)
+{
+	static Cdma_trace trace(env, alloc);
+	return trace;
+}
+
+
+void Cdma_trace::configure(Genode::Xml_node trace)
+{
+	Genode::Lock::Guard guard(_lock);
+	if(_records)
+		return;
+
+	_max = Genode::max(trace.attribute_value("records", 4096U), 1U);
+	_records = (Record *)_alloc.alloc(_max*sizeof(Record));
+	_timer.construct(_env);
+	_reporter.construct(_env, "cdma_trace", "cdma_trace");
+}
+
+
+void Cdma_trace::checkpoint_begin()
+{
+	if(!enabled())
+		return;
+
+	Genode::Lock::Guard guard(_lock);
+	_checkpoint++;
+	_checkpoint_start = _timer->elapsed_us();
+}
+
+
+void Cdma_trace::checkpoint_end()
+{
+	if(!enabled())
+		return;
+
+	Genode::Lock::Guard guard(_lock);
+	if(_checkpoint_count < MAX_CHECKPOINTS)
+		_checkpoints[_checkpoint_count++] = Checkpoint {
+			_checkpoint, (Genode::uint32_t)(_timer->elapsed_us() - _checkpoint_start) };
+	_report();
+}
+
+
+void Cdma_trace::record(Genode::uint64_t start_us, Genode::size_t size, Engine engine,
+			unsigned flags)
+{
+	if(!enabled())
+		return;
+
+	Genode::uint64_t const end_us = _timer->elapsed_us();
+
+	Genode::Lock::Guard guard(_lock);
+	if(_count == _max) {
+		_dropped++;
+		return;
+	}
+
+	_records[_count++] = Record {
+		(Genode::uint32_t)(start_us - _checkpoint_start),
+		(Genode::uint32_t)(end_us - start_us),
+		(Genode::uint32_t)size, _checkpoint,
+		(Genode::uint8_t)engine, (Genode::uint8_t)flags };
+}
+
+
+void Cdma_trace::_report()
+{
+	static char const *engines[] = { "cpu", "cdma", "hybrid", "replica", "sparse" };
+
+	_reporter->generate([&] (Genode::Xml_generator &xml) {
+		xml.attribute("dropped", _dropped);
+
+		/* the records are in checkpoint order */
+		unsigned r = 0;
+		for(unsigned c = 0; c < _checkpoint_count; c++) {
+			xml.node("checkpoint", [&] () {
+				xml.attribute("id", _checkpoints[c].id);
+				xml.attribute("us", _checkpoints[c].duration_us);
+
+				for(; r < _count && _records[r].checkpoint == _checkpoints[c].id; r++) {
+					Record const &rec = _records[r];
+					xml.node("copy", [&] () {
+						xml.attribute("size", rec.size);
+						xml.attribute("start", rec.start_us);
+						xml.attribute("us", rec.duration_us);
+						xml.attribute("engine", engines[rec.engine]);
+						xml.attribute("cached", rec.flags & CACHED ? "yes" : "no");
+						xml.attribute("contiguous", rec.flags & CONTIGUOUS ? "yes" : "no");
+						xml.attribute("fallback", rec.flags & FALLBACK ? "yes" : "no");
+					});
+				}
+			});
+		}
+	});
+}
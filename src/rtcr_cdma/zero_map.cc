@@ -0,0 +1,81 @@
+/*
+ * \brief  Zero pages of a checkpointed ram dataspace
+ * \author Johannes Fischer
+ * \date   2019-10-18
+ */
+
+#include <rtcr_cdma/zero_map.h>
+#include <cdma/soft_engine.h>
+#include <util/string.h>
+
+using namespace Rtcr;
+
+
+Cdma_zero_map::Cdma_zero_map(Genode::Allocator &alloc, Genode::size_t size, bool image_zero)
+	:
+	_alloc(alloc),
+	_size(size),
+	_pages((size + PAGE_SIZE - 1) / PAGE_SIZE),
+	_next((Genode::uint8_t *)alloc.alloc(_pages)),
+	_image((Genode::uint8_t *)alloc.alloc(_pages))
+{
+	Genode::memset(_next, 0, _pages);
+	Genode::memset(_image, image_zero, _pages);
+}
+
+
+Cdma_zero_map::~Cdma_zero_map()
+{
+	_alloc.free(_image, _pages);
+	_alloc.free(_next, _pages);
+}
+
+
+Genode::size_t Cdma_zero_map::scan(void const *src)
+{
+	char const *page = (char const *)src;
+	Genode::size_t zero_pages = 0;
+
+	for(Genode::size_t i = 0; i < _pages; i++) {
+		Genode::size_t const len = Genode::min((Genode::size_t)PAGE_SIZE, _size - i*PAGE_SIZE);
+		_next[i] = Cdma::Soft_engine::zero_kernel(page + i*PAGE_SIZE, len);
+		zero_pages += _next[i];
+	}
+
+	if(zero_pages < _pages >> MIN_ZERO_SHIFT)
+		_skip = SKIPPED_SCANS;
+	return zero_pages;
+}
+
+
+void Cdma_zero_map::copied_without_scan()
+{
+	if(_skip)
+		_skip--;
+	invalidate();
+}
+
+
+void Cdma_zero_map::commit()
+{
+	Genode::memcpy(_image, _next, _pages);
+}
+
+
+void Cdma_zero_map::invalidate()
+{
+	Genode::memset(_image, 0, _pages);
+}
+
+
+bool Cdma_zero_map::zero(Genode::size_t offset, Genode::size_t size) const
+{
+	if(!size || offset >= _size)
+		return false;
+
+	Genode::size_t const last = Genode::min(offset + size, _size) - 1;
+	for(Genode::size_t page = offset / PAGE_SIZE; page <= last / PAGE_SIZE; page++)
+		if(!_image[page])
+			return false;
+	return true;
+}
@@ -0,0 +1,151 @@
+/*
+ * \brief  Test of descriptor chains, whose length is not a multiple of the
+ *         interrupt threshold of the CDMA. Each chain has to complete by its
+ *         interrupt instead of the watchdog of the driver.
+ * \author Johannes Fischer
+ * \date   2019-10-21
+ */
+
+
+#include <base/component.h>
+#include <base/log.h>
+#include <base/attached_ram_dataspace.h>
+#include <base/attached_dataspace.h>
+#include <cdma_session/connection.h>
+#include <dataspace/client.h>
+#include <timer_session/connection.h>
+
+
+namespace Rtcr {
+	class Irq_threshold;
+}
+
+class Rtcr::Irq_threshold
+{
+	enum {
+		ROW_SIZE = 64,
+		ROWS     = 300,     /* more than the 8-bit threshold */
+		SIZE     = 2*ROWS*ROW_SIZE,
+
+		/* a completion by the watchdog takes the timeout of the driver */
+		MAX_US   = 500000,
+	};
+
+	Genode::Env &env;
+	Timer::Connection timer { env };
+	Cdma::Connection cdma { env };
+
+	Genode::Attached_ram_dataspace src { env.ram(), env.rm(), SIZE, Genode::UNCACHED };
+	Genode::Attached_ram_dataspace dst { env.ram(), env.rm(), SIZE, Genode::UNCACHED };
+	Genode::addr_t const src_addr = Genode::Dataspace_client(src.cap()).phys_addr();
+	Genode::addr_t const dst_addr = Genode::Dataspace_client(dst.cap()).phys_addr();
+
+	unsigned failed = 0;
+
+	void prepare()
+	{
+		for(unsigned i = 0; i < SIZE; i++)
+			src.local_addr<char>()[i] = (char)(i*7 + 1);
+		Genode::memset(dst.local_addr<char>(), 0, SIZE);
+	}
+
+	/**
+	 * Run `transfer` and check that it completes in time and that every
+	 * second row is copied
+	 */
+	template <typename FN>
+	void check(char const *name, FN const &transfer)
+	{
+		prepare();
+
+		Genode::uint64_t const start = timer.elapsed_us();
+		try {
+			transfer();
+		} catch (Cdma::Exception &) {
+			Genode::error(name, ": transfer failed");
+			failed++;
+			return;
+		}
+		Genode::uint64_t const us = timer.elapsed_us() - start;
+
+		bool copied = true;
+		for(unsigned row = 0; row < ROWS; row++)
+			copied &= !Genode::memcmp(dst.local_addr<char>() + 2*row*ROW_SIZE,
+						  src.local_addr<char>() + 2*row*ROW_SIZE, ROW_SIZE);
+
+		bool const in_time = us < MAX_US;
+		Genode::log(name, ": ", us, " us", copied ? "" : ", content differs",
+			    in_time ? "" : ", completed by the watchdog");
+		if(!copied || !in_time)
+			failed++;
+	}
+
+public:
+
+	Irq_threshold(Genode::Env &env_) : env(env_)
+	{
+		if(!cdma.is_supported()) {
+			Genode::error("CDMA Driver is not supported.");
+			return;
+		}
+
+		Genode::Attached_dataspace batch_ds(env.rm(), cdma.batch_dataspace());
+		Cdma::Batch &batch = *batch_ds.local_addr<Cdma::Batch>();
+
+		check("stride of 300 rows", [&] () {
+			cdma.stride(Cdma::Stride { dst_addr, 2*ROW_SIZE, src_addr, 2*ROW_SIZE,
+						   ROW_SIZE, ROWS }); });
+
+		/* 256 copies exceed the threshold of 255 by one, 44 stay below it */
+		check("batch of 256+44 copies", [&] () {
+			for(unsigned i = 0; i < Cdma::Batch::MAX; i++)
+				batch.copy[i] = Cdma::Copy { dst_addr + 2*i*ROW_SIZE,
+							     src_addr + 2*i*ROW_SIZE, ROW_SIZE };
+			cdma.batch(Cdma::Batch::MAX);
+
+			for(unsigned i = Cdma::Batch::MAX; i < ROWS; i++)
+				batch.copy[i - Cdma::Batch::MAX] =
+					Cdma::Copy { dst_addr + 2*i*ROW_SIZE, src_addr + 2*i*ROW_SIZE,
+						     ROW_SIZE };
+			cdma.batch(ROWS - Cdma::Batch::MAX);
+		});
+
+		/* 255 copies complete the threshold exactly and are signalled by
+		 * IOC without the delay interrupt, the remaining 45 are not */
+		check("batch of 255+45 copies", [&] () {
+			for(unsigned i = 0; i < 255; i++)
+				batch.copy[i] = Cdma::Copy { dst_addr + 2*i*ROW_SIZE,
+							     src_addr + 2*i*ROW_SIZE, ROW_SIZE };
+			cdma.batch(255);
+
+			for(unsigned i = 255; i < ROWS; i++)
+				batch.copy[i - 255] =
+					Cdma::Copy { dst_addr + 2*i*ROW_SIZE, src_addr + 2*i*ROW_SIZE,
+						     ROW_SIZE };
+			cdma.batch(ROWS - 255);
+		});
+
+		/* an interval above the 8-bit threshold is clamped to it */
+		cdma.progress_interval(ROWS);
+		check("stride with progress interval 300", [&] () {
+			cdma.stride(Cdma::Stride { dst_addr, 2*ROW_SIZE, src_addr, 2*ROW_SIZE,
+						   ROW_SIZE, ROWS }); });
+
+		/* 300 descriptors with an interrupt every 7 descriptors */
+		cdma.progress_interval(7);
+		check("stride with progress interval 7", [&] () {
+			cdma.stride(Cdma::Stride { dst_addr, 2*ROW_SIZE, src_addr, 2*ROW_SIZE,
+						   ROW_SIZE, ROWS }); });
+		cdma.progress_interval(0);
+
+		Genode::log(failed ? "Test failed." : "Test successful.");
+		Genode::log("the_end");
+	}
+};
+
+Genode::size_t Component::stack_size() { return 16*1024; }
+
+void Component::construct(Genode::Env &env)
+{
+	static Rtcr::Irq_threshold test(env);
+}
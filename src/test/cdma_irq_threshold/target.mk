@@ -0,0 +1,3 @@
+TARGET = cdma_irq_threshold
+SRC_CC = main.cc
+LIBS   = base
@@ -0,0 +1,216 @@
+/*
+ * \brief  Replay of a checkpoint copy trace, which is reported by the cdma
+ *         module with `<trace/>`. The copies are issued against the
+ *         configured CDMA backend and their latencies and throughput are
+ *         reported.
+ * \author Johannes Fischer
+ * \date   2019-10-17
+ */
+
+
+#include <base/component.h>
+#include <base/log.h>
+#include <base/attached_rom_dataspace.h>
+#include <base/heap.h>
+#include <timer_session/connection.h>
+#include <util/reconstructible.h>
+#include <util/misc_math.h>
+#include <cdma_session/connection.h>
+#include <cdma/local_session.h>
+#include <cdma/soft_session.h>
+
+
+namespace Rtcr {
+	class Replay;
+}
+
+class Rtcr::Replay
+{
+	enum { HISTOGRAM = 32 };
+
+	Genode::Env &env;
+	Genode::Heap heap { env.ram(), env.rm() };
+	Genode::Attached_rom_dataspace config { env, "config" };
+	Genode::Attached_rom_dataspace trace { env, "cdma_trace" };
+	Timer::Connection timer { env };
+
+	Genode::Constructible<Cdma::Connection> connection;
+	Genode::Constructible<Cdma::Local_session> local;
+	Genode::Constructible<Cdma::Soft_session> soft;
+
+	/* copies recorded by the CPU are only replayed with `all="true"` */
+	bool all;
+	bool pace;
+
+	Genode::uint32_t *latencies = nullptr;
+	unsigned count = 0;
+	unsigned failed = 0;
+	Genode::uint64_t bytes = 0;
+	Genode::uint64_t replay_us = 0;
+	Genode::uint64_t recorded_us = 0;
+	unsigned histogram[HISTOGRAM] { };
+
+	/**
+	 * Session of the configured backend, see `README`
+	 */
+	Cdma::Session &open(Genode::Xml_node node)
+	{
+		typedef Genode::String<16> Backend;
+		Backend const backend = node.attribute_value("backend", Backend("cdma_drv"));
+
+		if(backend == "driver") {
+			local.construct(env, heap, Cdma::Driver::factory(env, node.sub_node("driver")));
+			return *local;
+		}
+		if(backend == "software") {
+			soft.construct(env, heap, Cdma::Soft_engine::factory(env, heap,
+					node.attribute_value("threads", 0U)));
+			return *soft;
+		}
+		connection.construct(env);
+		return *connection;
+	}
+
+	bool replayed(Genode::Xml_node copy) const
+	{
+		typedef Genode::String<16> Engine;
+		return all || copy.attribute_value("engine", Engine()) != "cpu";
+	}
+
+	void sort()
+	{
+		/* shell sort, the trace is small */
+		for(unsigned gap = count/2; gap; gap /= 2)
+			for(unsigned i = gap; i < count; i++)
+				for(unsigned j = i; j >= gap && latencies[j - gap] > latencies[j]; j -= gap) {
+					Genode::uint32_t const l = latencies[j];
+					latencies[j] = latencies[j - gap];
+					latencies[j - gap] = l;
+				}
+	}
+
+	Genode::uint32_t percentile(unsigned p) const
+	{
+		return count ? latencies[((count - 1)*p)/100] : 0;
+	}
+
+	void report()
+	{
+		using namespace Genode;
+
+		sort();
+
+		/* bytes per microsecond are MB/s */
+		uint64_t const mib_s = replay_us ? (bytes*1000000/replay_us) >> 20 : 0;
+
+		log("replay: ", count, " copies, ", failed, " failed, ",
+		    Number_of_bytes((size_t)bytes), " in ", replay_us, " us (recorded ",
+		    recorded_us, " us), ", mib_s, " MiB/s");
+		log("replay: latency us p50=", percentile(50), " p90=", percentile(90),
+		    " p99=", percentile(99), " max=", percentile(100));
+
+		for(unsigned i = 0; i < HISTOGRAM; i++)
+			if(histogram[i])
+				log("replay: [", i ? 1ULL << i : 0ULL, ", ", 1ULL << (i + 1), ") us: ",
+				    histogram[i]);
+	}
+
+public:
+
+	Replay(Genode::Env &env_) : env(env_)
+	{
+		using namespace Genode;
+
+		Xml_node const node = config.xml();
+		all = node.attribute_value("all", false);
+		pace = node.attribute_value("pace", false);
+		unsigned const rounds = max(node.attribute_value("rounds", 1U), 1U);
+
+		/* the largest copy bounds the dataspaces, every copy starts at 0 */
+		size_t max_size = 0;
+		unsigned copies = 0;
+		trace.xml().for_each_sub_node("checkpoint", [&] (Xml_node checkpoint) {
+			checkpoint.for_each_sub_node("copy", [&] (Xml_node copy) {
+				if(!replayed(copy))
+					return;
+				max_size = max(max_size, copy.attribute_value("size", 0UL));
+				copies++;
+			});
+		});
+		if(!copies) {
+			warning("replay: the trace contains no copies");
+			log("test completed.");
+			return;
+		}
+
+		Cdma::Session &cdma = open(node);
+		if(!cdma.is_supported())
+			warning("replay: the backend reports no CDMA");
+
+		max_size = align_addr(max_size, 12);
+		Ram_dataspace_capability src = env.ram().alloc(max_size, UNCACHED);
+		Ram_dataspace_capability dst = env.ram().alloc(max_size, UNCACHED);
+		char *s = env.rm().attach(src);
+		memset(s, 0x5a, max_size);
+		env.rm().detach(s);
+		if(soft.constructed()) {
+			soft->attach(src);
+			soft->attach(dst);
+		}
+
+		latencies = (uint32_t *)heap.alloc(copies*rounds*sizeof(uint32_t));
+
+		log("replay: ", copies, " copies of up to ", Number_of_bytes(max_size),
+		    ", ", rounds, " rounds", pace ? ", paced" : "");
+
+		for(unsigned round = 0; round < rounds; round++) {
+			trace.xml().for_each_sub_node("checkpoint", [&] (Xml_node checkpoint) {
+				uint64_t const begin = timer.elapsed_us();
+				uint64_t checkpoint_us = 0;
+
+				checkpoint.for_each_sub_node("copy", [&] (Xml_node copy) {
+					if(!replayed(copy))
+						return;
+
+					size_t const size = copy.attribute_value("size", 0UL);
+					if(pace) {
+						/* issue the copy at its recorded offset into the checkpoint */
+						uint64_t const start = copy.attribute_value("start", 0UL);
+						uint64_t const now = timer.elapsed_us() - begin;
+						if(start > now)
+							timer.usleep(start - now);
+					}
+
+					uint64_t const t = timer.elapsed_us();
+					try {
+						cdma.copy(dst, 0, src, 0, size);
+					} catch (Cdma::Exception &) {
+						failed++;
+					}
+					uint32_t const us = (uint32_t)(timer.elapsed_us() - t);
+
+					latencies[count++] = us;
+					histogram[min(log2(max(us, 1U)), (uint32_t)HISTOGRAM - 1)]++;
+					bytes += size;
+					checkpoint_us += us;
+					replay_us += us;
+					recorded_us += copy.attribute_value("us", 0U);
+				});
+
+				log("replay: checkpoint ", checkpoint.attribute_value("id", 0U),
+				    " recorded ", checkpoint.attribute_value("us", 0U), " us, copies ",
+				    checkpoint_us, " us");
+			});
+		}
+
+		report();
+		log("test completed.");
+	}
+};
+
+Genode::size_t Component::stack_size() { return 16*1024; }
+
+void Component::construct(Genode::Env &env)
+{
+	static Rtcr::Replay replay(env);
+}
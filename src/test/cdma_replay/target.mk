@@ -0,0 +1,3 @@
+TARGET = cdma_replay
+SRC_CC = main.cc
+LIBS   = base cdma
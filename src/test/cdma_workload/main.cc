@@ -0,0 +1,120 @@
+/*
+ * \brief  Synthetic workload for checkpoint benchmarks. The component
+ *         allocates a configurable number of cached and uncached dataspaces
+ *         and periodically dirties pages of them.
+ * \author Johannes Fischer
+ * \date   2019-09-24
+ */
+
+
+#include <base/component.h>
+#include <base/log.h>
+#include <base/attached_rom_dataspace.h>
+#include <base/allocator.h>
+#include <base/heap.h>
+#include <timer_session/connection.h>
+#include <util/list.h>
+
+
+namespace Rtcr {
+	class Workload;
+}
+
+class Rtcr::Workload
+{
+	enum { PAGE_SIZE = 4096 };
+
+	struct Dataspace : Genode::List<Dataspace>::Element
+	{
+		Genode::Ram_dataspace_capability cap;
+		char *addr;
+
+		Dataspace(Genode::Ram_dataspace_capability _cap, char *_addr)
+			: cap(_cap), addr(_addr) {}
+	};
+
+	Genode::Env &env;
+	Genode::Heap heap { env.ram(), env.rm() };
+
+	/*
+	 * The configuration is read from its own ROM, because the `config` ROM
+	 * of a child of `rtcr_app` is the configuration of `rtcr_app`.
+	 */
+	Genode::Attached_rom_dataspace config { env, "cdma_workload.config" };
+
+	Timer::Connection timer { env };
+	Genode::Signal_handler<Workload> period_handler { env.ep(), *this,
+	                                                  &Workload::handle_period };
+
+	Genode::List<Dataspace> dataspaces;
+	unsigned count;
+	Genode::size_t size;
+	unsigned dirty_pages;
+	unsigned long rounds = 0;
+	unsigned long seed = 1;
+
+	/* linear congruential generator, good enough to spread the writes */
+	unsigned long random()
+	{
+		seed = seed*1103515245 + 12345;
+		return seed >> 8;
+	}
+
+	void handle_period()
+	{
+		Genode::size_t const pages = size / PAGE_SIZE;
+
+		for (unsigned i = 0; i < dirty_pages; i++) {
+			unsigned ds_index = random() % count;
+			Dataspace *ds = dataspaces.first();
+			for (; ds_index; ds_index--)
+				ds = ds->next();
+
+			Genode::size_t page = random() % pages;
+			ds->addr[page*PAGE_SIZE + random() % PAGE_SIZE] = (char)rounds;
+		}
+
+		if (++rounds % 100 == 0)
+			Genode::log("workload: ", rounds, " rounds");
+	}
+
+public:
+
+	Workload(Genode::Env &env_) : env(env_)
+	{
+		using namespace Genode;
+
+		Xml_node const node = config.xml();
+		count = max(node.attribute_value("count", 16U), 1U);
+		size = max((size_t)node.attribute_value("size", Number_of_bytes(1024*1024)),
+		           (size_t)PAGE_SIZE);
+		unsigned const uncached = min(node.attribute_value("uncached", 50U), 100U);
+		dirty_pages = node.attribute_value("dirty", 64U);
+		unsigned const period_ms = node.attribute_value("period_ms", 100U);
+
+		log("workload: ", count, " dataspaces of ", Number_of_bytes(size),
+		    ", ", uncached, "% uncached, ", dirty_pages, " dirty pages every ",
+		    period_ms, " ms");
+
+		for (unsigned i = 0; i < count; i++) {
+			/* distribute the uncached dataspaces evenly */
+			bool const is_uncached = (i*uncached) / 100 != ((i + 1)*uncached) / 100;
+			Ram_dataspace_capability cap =
+				env.ram().alloc(size, is_uncached ? UNCACHED : CACHED);
+
+			char *addr = env.rm().attach(cap);
+			memset(addr, (char)i, size);
+			dataspaces.insert(new (heap) Dataspace(cap, addr));
+		}
+
+		timer.sigh(period_handler);
+		timer.trigger_periodic(period_ms*1000);
+	}
+};
+
+Genode::size_t Component::stack_size() { return 16*1024; }
+
+void Component::construct(Genode::Env &env)
+{
+	static Rtcr::Workload workload(env);
+}
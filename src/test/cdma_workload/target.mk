@@ -0,0 +1,3 @@
+TARGET = cdma_workload
+SRC_CC = main.cc
+LIBS   = base
@@ -0,0 +1,325 @@
+/*
+ * \brief  Test of the paths of the cdma module, which do not need a
+ *         checkpointed child: the lazy restore of a dataspace by page faults
+ *         and a background sweep, the eager mapping of the working set, and
+ *         the fan-out of a checkpoint to its image and replica, the
+ *         recycling of destinations by the arena, the batched copy of the
+ *         dataspaces of a forked child, and the budget of the history.
+ * \author Johannes Fischer
+ * \date   2019-10-22
+ */
+
+
+#include <base/component.h>
+#include <base/log.h>
+#include <base/heap.h>
+#include <base/entrypoint.h>
+#include <base/attached_ram_dataspace.h>
+#include <base/attached_dataspace.h>
+#include <cdma_session/connection.h>
+#include <dataspace/client.h>
+#include <rtcr_cdma/backend.h>
+#include <rtcr_cdma/copy_queue.h>
+#include <rtcr_cdma/dst_arena.h>
+#include <rtcr_cdma/fork.h>
+#include <rtcr_cdma/history.h>
+#include <rtcr_cdma/lazy_restore.h>
+#include <rtcr_cdma/prefault.h>
+#include <rtcr_cdma/zero_map.h>
+
+
+namespace Rtcr {
+	class Restore_test;
+}
+
+class Rtcr::Restore_test
+{
+	enum {
+		PAGE_SIZE = 4096,
+		PAGES     = 64,
+		SIZE      = PAGES*PAGE_SIZE,
+		WINDOW    = 4*PAGE_SIZE,
+
+		/* the pages of the third window are zero */
+		ZERO_FIRST = 8,
+		ZERO_LAST  = 11,
+	};
+
+	Genode::Env &env;
+	Genode::Heap heap { env.ram(), env.rm() };
+	Cdma::Connection cdma { env };
+
+	/* the session is shared like the one of rtcr */
+	Cdma_backend backend { env, cdma };
+	Cdma_copy_queue &copy_queue = Cdma_copy_queue::factory(env);
+
+	/* the faults of a managed dataspace are resolved by another thread
+	 * than the touching one */
+	Genode::Entrypoint fault_ep { env, 16*1024, "fault_ep", Genode::Affinity::Location() };
+
+	Genode::Attached_ram_dataspace checkpoint { env.ram(), env.rm(), SIZE, Genode::UNCACHED };
+	Genode::addr_t const checkpoint_addr =
+		Genode::Dataspace_client(checkpoint.cap()).phys_addr();
+
+	unsigned failed = 0;
+
+	void check(char const *name, bool ok)
+	{
+		Genode::log(name, ok ? ": ok" : ": failed");
+		if(!ok)
+			failed++;
+	}
+
+	static bool zero_page(unsigned page) {
+		return page >= ZERO_FIRST && page <= ZERO_LAST; }
+
+	void prepare()
+	{
+		char *c = checkpoint.local_addr<char>();
+		for(unsigned page = 0; page < PAGES; page++)
+			Genode::memset(c + page*PAGE_SIZE, zero_page(page) ? 0 : page + 1, PAGE_SIZE);
+	}
+
+	void test_lazy_restore()
+	{
+		Genode::Attached_ram_dataspace target { env.ram(), env.rm(), SIZE, Genode::UNCACHED };
+		Genode::memset(target.local_addr<char>(), 0xff, SIZE);
+
+		/* the zero window is written by a memset */
+		Cdma_zero_map zero_map(heap, SIZE, false);
+		zero_map.scan(checkpoint.local_addr<char>());
+		zero_map.commit();
+
+		/* a target, which cannot hold the checkpoint, is rejected */
+		Genode::Attached_ram_dataspace small { env.ram(), env.rm(), PAGE_SIZE, Genode::UNCACHED };
+		bool rejected = false;
+		try {
+			Cdma_lazy_restore(env, fault_ep, heap, backend, copy_queue,
+					  checkpoint.cap(), checkpoint_addr, small.cap(), SIZE,
+					  WINDOW, &zero_map);
+		} catch (Cdma_lazy_restore::Unsupported_target) { rejected = true; }
+		check("lazy restore: unsupported target", rejected);
+
+		Cdma_lazy_restore restore(env, fault_ep, heap, backend, copy_queue,
+					  checkpoint.cap(), checkpoint_addr, target.cap(), SIZE,
+					  WINDOW, &zero_map);
+		Genode::Attached_dataspace managed(env.rm(), restore.dataspace());
+		char const *m = managed.local_addr<char>();
+
+		/* the touch of the last window may precede the sweep */
+		check("lazy restore: fault in last window",
+		      m[SIZE - 1] == (char)PAGES);
+
+		copy_queue.join();
+		check("lazy restore: complete after sweep", restore.complete());
+		check("lazy restore: content",
+		      !Genode::memcmp(m, checkpoint.local_addr<char>(), SIZE));
+		check("lazy restore: zero window",
+		      !m[ZERO_FIRST*PAGE_SIZE] && !m[(ZERO_LAST + 1)*PAGE_SIZE - 1]);
+	}
+
+	void test_prefault()
+	{
+		enum { DS_PAGES = 16, DS_SIZE = DS_PAGES*PAGE_SIZE };
+
+		/* pages 2, 3 and 9 are written after the last checkpoint */
+		Genode::Attached_ram_dataspace ds { env.ram(), env.rm(), DS_SIZE };
+		char *image = (char *)heap.alloc(DS_SIZE);
+		Genode::memset(image, 0, DS_SIZE);
+		char *next = ds.local_addr<char>();
+		next[2*PAGE_SIZE] = next[3*PAGE_SIZE + 1] = next[10*PAGE_SIZE - 1] = 1;
+
+		Cdma_working_set working_set(heap, DS_SIZE);
+		working_set.update(image, next, DS_SIZE);
+		heap.free(image, DS_SIZE);
+		check("prefault: working set",
+		      working_set.hot(2) && working_set.hot(3) && working_set.hot(9) &&
+		      !working_set.hot(1) && !working_set.hot(4) && !working_set.hot(10));
+
+		/* the range starts inside of page 1 and ends inside of page 13 */
+		Cdma_prefault prefault(heap);
+		Genode::addr_t const virt = (Genode::addr_t)next;
+		unsigned runs = 0;
+		working_set.for_each_hot_run(PAGE_SIZE + 100, 12*PAGE_SIZE,
+			[&] (Genode::size_t offset, Genode::size_t size) {
+				prefault.add(virt + offset, size);
+				runs++;
+			});
+		check("prefault: hot runs", runs == 2);
+
+		/* an adjacent and an overlapping range are merged */
+		prefault.add(virt + 4*PAGE_SIZE, PAGE_SIZE);
+		prefault.add(virt + 9*PAGE_SIZE, 2*PAGE_SIZE);
+		check("prefault: merged ranges", prefault.apply(env.pd()) == 2);
+	}
+
+	void test_replica()
+	{
+		/* image and replica are taken from the arena like the ones of a
+		 * checkpointed dataspace with `<replica/>` */
+		Cdma_dst_arena &arena = Cdma_dst_arena::factory(env, heap);
+		Cdma_dst_arena::Owner const owner = arena.new_owner();
+		Cdma_dst_arena::Buffer &image   = arena.acquire(SIZE, Genode::UNCACHED, owner);
+		Cdma_dst_arena::Buffer &replica = arena.acquire(SIZE, Genode::UNCACHED, owner);
+
+		Cdma::Destinations dsts { { image.phys_addr, replica.phys_addr }, 2 };
+		bool transferred = true;
+		try { cdma.fanout(dsts, checkpoint_addr, SIZE); }
+		catch (Cdma::Exception &) { transferred = false; }
+		check("replica: fan-out", transferred);
+		image.zeroed = replica.zeroed = false;
+
+		{
+			Genode::Attached_dataspace i(env.rm(), image.cap);
+			Genode::Attached_dataspace r(env.rm(), replica.cap);
+			char const *c = checkpoint.local_addr<char>();
+			check("replica: image",
+			      !Genode::memcmp(i.local_addr<char>(), c, SIZE));
+			check("replica: replica",
+			      !Genode::memcmp(r.local_addr<char>(), c, SIZE));
+		}
+
+		arena.release(replica);
+		arena.release(image);
+	}
+
+	void test_fork()
+	{
+		enum { FORKED = 3 };
+
+		/* the forked dataspaces start from the checkpoint with different
+		 * sizes */
+		Genode::size_t const sizes[FORKED] = { PAGE_SIZE, SIZE / 2, SIZE };
+		Genode::Ram_dataspace_capability forked[FORKED];
+		for(unsigned i = 0; i < FORKED; i++)
+			forked[i] = env.ram().alloc(sizes[i], Genode::UNCACHED);
+
+		Cdma_fork fork(env.rm());
+
+		auto add_all = [&] () {
+			for(unsigned i = 0; i < FORKED; i++)
+				fork.add(forked[i], Genode::Dataspace_client(forked[i]).phys_addr(),
+					 checkpoint.cap(), checkpoint_addr, sizes[i]);
+		};
+
+		/* compares and clears the forked dataspaces */
+		auto forked_equal = [&] () {
+			bool equal = true;
+			for(unsigned i = 0; i < FORKED; i++) {
+				Genode::Attached_dataspace f(env.rm(), forked[i]);
+				equal &= !Genode::memcmp(f.local_addr<char>(),
+							 checkpoint.local_addr<char>(), sizes[i]);
+				Genode::memset(f.local_addr<char>(), 0, sizes[i]);
+			}
+			return equal;
+		};
+
+		add_all();
+		unsigned first_failed = 0;
+		backend.apply([&] (Cdma::Session &session, Cdma::Batch &batch) {
+			first_failed = fork.submit(session, batch); });
+		check("fork: batch", first_failed == FORKED);
+		fork.complete(first_failed);
+		check("fork: content", fork.empty() && forked_equal());
+
+		/* the fallback copies all dataspaces from the failed one on */
+		add_all();
+		fork.complete(0);
+		check("fork: content by CPU", fork.empty() && forked_equal());
+
+		for(unsigned i = 0; i < FORKED; i++)
+			env.ram().free(forked[i]);
+	}
+
+	void test_arena()
+	{
+		Cdma_dst_arena &arena = Cdma_dst_arena::factory(env, heap);
+
+		bool rejected = false;
+		try { arena.acquire(0, Genode::UNCACHED, arena.new_owner()); }
+		catch (Cdma_dst_arena::Invalid_size) { rejected = true; }
+		check("arena: size 0 rejected", rejected);
+
+		/* the buffers of the replica test are recycled by a slightly
+		 * smaller request of another child */
+		Cdma_dst_arena::Buffer &buffer =
+			arena.acquire(SIZE - PAGE_SIZE + 1, Genode::UNCACHED, arena.new_owner());
+		check("arena: best fit", buffer.size == SIZE);
+
+		{
+			Genode::Attached_dataspace b(env.rm(), buffer.cap);
+			char const *c = b.local_addr<char>();
+			bool zero = true;
+			for(Genode::size_t i = 0; i < buffer.size && zero; i++)
+				zero = !c[i];
+			check("arena: zeroed for another child", zero);
+		}
+
+		arena.release(buffer);
+	}
+
+	void test_history()
+	{
+		enum { IMAGE_PAGES = 8, IMAGE_SIZE = IMAGE_PAGES*PAGE_SIZE };
+
+		/* a generation of two pages fits, two of them do not */
+		Cdma_history history(heap, 4, 3*PAGE_SIZE);
+
+		char *image = (char *)heap.alloc(IMAGE_SIZE);
+		char *next  = (char *)heap.alloc(IMAGE_SIZE);
+		char *first = (char *)heap.alloc(IMAGE_SIZE);
+
+		auto advance = [&] (unsigned pages, char value) {
+			Genode::memcpy(next, image, IMAGE_SIZE);
+			for(unsigned page = 0; page < pages; page++)
+				next[page*PAGE_SIZE] = value;
+			history.record(image, next, IMAGE_SIZE);
+			Genode::memcpy(image, next, IMAGE_SIZE);
+		};
+
+		Genode::memset(image, 0, IMAGE_SIZE);
+		advance(2, 1);
+		Genode::memcpy(first, image, IMAGE_SIZE);
+		advance(2, 2);
+		check("history: oldest generation dropped by budget", history.count() == 1);
+
+		check("history: rollback", history.rollback(image, 1) &&
+		      !Genode::memcmp(image, first, IMAGE_SIZE));
+
+		advance(1, 3);
+		advance(4, 4);
+		check("history: generation above budget empties", history.count() == 0);
+
+		heap.free(first, IMAGE_SIZE);
+		heap.free(next, IMAGE_SIZE);
+		heap.free(image, IMAGE_SIZE);
+	}
+
+public:
+
+	Restore_test(Genode::Env &env_) : env(env_)
+	{
+		if(!cdma.is_supported()) {
+			Genode::error("CDMA Driver is not supported.");
+			return;
+		}
+
+		prepare();
+		test_lazy_restore();
+		test_prefault();
+		test_replica();
+		test_arena();
+		test_fork();
+		test_history();
+
+		Genode::log(failed ? "Test failed." : "Test successful.");
+		Genode::log("the_end");
+	}
+};
+
+Genode::size_t Component::stack_size() { return 16*1024; }
+
+void Component::construct(Genode::Env &env)
+{
+	static Rtcr::Restore_test test(env);
+}
@@ -0,0 +1,3 @@
+TARGET = rtcr_cdma_restore
+SRC_CC = main.cc
+LIBS   = base cdma rtcr_cdma